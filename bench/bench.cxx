@@ -0,0 +1,344 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include <cxxopts.hpp>
+
+#include "engine.h"
+#include "golife.h"
+#include "kernels.h"
+#include "pattern.h"
+#include "thread_pool.h"
+
+namespace {
+
+struct Case
+{
+    std::string pattern;
+    double density;
+    int size;
+};
+
+struct Result
+{
+    std::string engine;
+    Case c;
+    std::int64_t generations;
+    double seconds;
+    double ns_per_cell;
+    double gens_per_sec;
+    long peak_rss_kib;
+    std::string check;
+};
+
+// Gosper glider gun, 36x9.
+const std::vector<std::pair<int, int>> GosperGun = {
+    {24, 0},
+    {22, 1}, {24, 1},
+    {12, 2}, {13, 2}, {20, 2}, {21, 2}, {34, 2}, {35, 2},
+    {11, 3}, {15, 3}, {20, 3}, {21, 3}, {34, 3}, {35, 3},
+    { 0, 4}, { 1, 4}, {10, 4}, {16, 4}, {20, 4}, {21, 4},
+    { 0, 5}, { 1, 5}, {10, 5}, {14, 5}, {16, 5}, {17, 5}, {22, 5}, {24, 5},
+    {10, 6}, {16, 6}, {24, 6},
+    {11, 7}, {15, 7},
+    {12, 8}, {13, 8},
+};
+
+gol::Board MakeBoard(const Case& c, unsigned seed)
+{
+    gol::Board b(c.size, c.size);
+    if (c.pattern == "soup") {
+        std::mt19937_64 rng(seed);
+        std::bernoulli_distribution alive(c.density);
+        for (int y = 0; y < c.size; ++y) {
+            for (int x = 0; x < c.size; ++x) {
+                if (alive(rng)) {
+                    b.set_live(x, y);
+                }
+            }
+        }
+    } else if (c.pattern == "blocks") {
+        // a still life: 2x2 blocks on a 4-cell grid
+        for (int y = 0; y + 1 < c.size; y += 4) {
+            for (int x = 0; x + 1 < c.size; x += 4) {
+                b.set_live(x, y);
+                b.set_live(x + 1, y);
+                b.set_live(x, y + 1);
+                b.set_live(x + 1, y + 1);
+            }
+        }
+    } else if (c.pattern == "guns") {
+        // one gun per 64x64 block, firing into the empty space to its right
+        for (int y0 = 0; y0 + 9 <= c.size; y0 += 64) {
+            for (int x0 = 0; x0 + 36 <= c.size; x0 += 64) {
+                for (auto&& [x, y] : GosperGun) {
+                    b.set_live(x0 + x, y0 + y);
+                }
+            }
+        }
+    }
+    return b;
+}
+
+// Peak resident set size of the whole process so far, so it only grows
+// from case to case.
+long PeakRssKib()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+bool Unbounded(const std::string& engine)
+{
+    return engine == "hashlife" || engine == "sparse";
+}
+
+// Reference result from Board::tick() with the scalar kernel.  For the
+// unbounded engines the reference board gets a dead margin wide enough
+// that nothing can reach its edge in `generations`, and is cropped back.
+gol::Board Reference(const gol::Board& start, std::int64_t generations, bool unbounded)
+{
+    const gol::Kernel saved = gol::active_kernel();
+    gol::set_kernel(gol::Kernel::Scalar);
+    const int margin = unbounded ? static_cast<int>(generations) + 1 : 0;
+    gol::Board b(start.nrows + 2*margin, start.ncols + 2*margin);
+    gol::place(b, start, margin, margin);
+    for (std::int64_t i = 0; i < generations; ++i) {
+        b = b.tick();
+    }
+    gol::set_kernel(saved);
+    gol::Board result(start.nrows, start.ncols);
+    for (int y = 0; y < start.nrows; ++y) {
+        for (int x = 0; x < start.ncols; ++x) {
+            if (b.live(x + margin, y + margin)) {
+                result.set_live(x, y);
+            }
+        }
+    }
+    return result;
+}
+
+std::string CrossCheck(const std::string& engine_name, gol::ThreadPool* pool,
+        const gol::Board& start, std::int64_t generations)
+{
+    auto engine = gol::make_engine(engine_name, pool);
+    engine->load(start);
+    engine->step(generations);
+    return engine->board() == Reference(start, generations, Unbounded(engine_name)) ? "ok" : "MISMATCH";
+}
+
+// Every kernel the CPU supports against the scalar one, including those
+// the engines would not pick on this machine.  Each generation is ticked
+// by both from the same board, on soups whose widths are not a multiple
+// of any vector width, under the specialized rules and one that is not.
+std::string KernelCheck(gol::Kernel k, int max_size, std::int64_t generations, unsigned seed)
+{
+    const gol::Rule rules[] = {
+        gol::CONWAY, gol::HIGHLIFE, gol::DAY_AND_NIGHT, gol::SEEDS,
+        gol::LIFE_WITHOUT_DEATH, gol::MAZE, gol::Rule{0x00a, 0x031},
+    };
+    std::mt19937_64 rng(seed);
+    for (int size = 1; size <= max_size; size = size*2 + 1) {
+        for (double density : {0.1, 0.35, 0.7}) {
+            for (gol::Rule rule : rules) {
+                gol::Board cur(size, size + 3);
+                std::bernoulli_distribution alive(density);
+                for (int y = 0; y < cur.nrows; ++y) {
+                    for (int x = 0; x < cur.ncols; ++x) {
+                        if (alive(rng)) {
+                            cur.set_live(x, y);
+                        }
+                    }
+                }
+                gol::Board expected(cur.nrows, cur.ncols);
+                gol::Board actual(cur.nrows, cur.ncols);
+                for (std::int64_t i = 0; i < generations; ++i) {
+                    gol::tick_rows(gol::Kernel::Scalar, cur, expected, 0, cur.nrows, rule);
+                    gol::tick_rows(k, cur, actual, 0, cur.nrows, rule);
+                    if (!(actual == expected)) {
+                        return "MISMATCH";
+                    }
+                    std::swap(cur, expected);
+                }
+            }
+        }
+    }
+    return "ok";
+}
+
+void WriteCsv(std::ostream& os, const std::vector<Result>& results)
+{
+    os << "engine,pattern,density,size,generations,seconds,ns_per_cell,gens_per_sec,peak_rss_kib,check\n";
+    for (auto&& r : results) {
+        os << r.engine << ',' << r.c.pattern << ',' << r.c.density << ',' << r.c.size << ','
+           << r.generations << ',' << r.seconds << ',' << r.ns_per_cell << ',' << r.gens_per_sec << ','
+           << r.peak_rss_kib << ',' << r.check << '\n';
+    }
+}
+
+void WriteJson(std::ostream& os, const std::vector<Result>& results)
+{
+    os << "[\n";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        os << "  {\"engine\": \"" << r.engine << "\", \"pattern\": \"" << r.c.pattern
+           << "\", \"density\": " << r.c.density << ", \"size\": " << r.c.size
+           << ", \"generations\": " << r.generations << ", \"seconds\": " << r.seconds
+           << ", \"ns_per_cell\": " << r.ns_per_cell << ", \"gens_per_sec\": " << r.gens_per_sec
+           << ", \"peak_rss_kib\": " << r.peak_rss_kib << ", \"check\": \"" << r.check << "\"}"
+           << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    os << "]\n";
+}
+
+std::vector<std::string> Split(const std::string& s)
+{
+    std::vector<std::string> result;
+    std::istringstream is(s);
+    std::string item;
+    while (std::getline(is, item, ',')) {
+        if (!item.empty()) {
+            result.push_back(item);
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    using Clock = std::chrono::steady_clock;
+
+    cxxopts::Options options("game-of-life-bench",
+            "Benchmark the simulation engines across board sizes, densities and patterns");
+    options.add_options()
+        ("e,engines", "comma-separated engines to run, default all", cxxopts::value<std::string>())
+        ("min-size", "smallest board side", cxxopts::value<int>()->default_value("64"))
+        ("max-size", "largest board side (sides double from min-size)", cxxopts::value<int>()->default_value("4096"))
+        ("densities", "comma-separated soup densities", cxxopts::value<std::string>()->default_value("0.05,0.25,0.5"))
+        ("patterns", "comma-separated patterns: soup, blocks, guns", cxxopts::value<std::string>()->default_value("soup,blocks,guns"))
+        ("budget", "cell updates per case, used to pick the generation count", cxxopts::value<double>()->default_value("1e9"))
+        ("max-generations", "upper bound on generations per case", cxxopts::value<std::int64_t>()->default_value("10000"))
+        ("check-size", "cross-check engines on boards up to this side", cxxopts::value<int>()->default_value("256"))
+        ("check-generations", "generations run by the cross-check", cxxopts::value<std::int64_t>()->default_value("64"))
+        ("t,threads", "worker threads, 0 for one per core", cxxopts::value<int>()->default_value("1"))
+        ("s,seed", "soup seed", cxxopts::value<unsigned>()->default_value("1"))
+        ("f,format", "output format: csv or json", cxxopts::value<std::string>()->default_value("csv"))
+        ("o,output", "write results to this file instead of stdout", cxxopts::value<std::string>())
+        ("h,help", "print usage")
+        ;
+
+    try {
+        auto args = options.parse(argc, argv);
+        if (args.count("help")) {
+            std::cout << options.help() << std::endl;
+            return 0;
+        }
+
+        const auto engines = args.count("engines") ? Split(args["engines"].as<std::string>()) : gol::engine_names();
+        const auto patterns = Split(args["patterns"].as<std::string>());
+        std::vector<double> densities;
+        for (auto&& d : Split(args["densities"].as<std::string>())) {
+            densities.push_back(std::stod(d));
+        }
+        const int nthreads = args["threads"].as<int>();
+        std::unique_ptr<gol::ThreadPool> pool;
+        if (nthreads != 1) {
+            pool = std::make_unique<gol::ThreadPool>(nthreads);
+        }
+
+        std::vector<Case> cases;
+        for (int size = args["min-size"].as<int>(); size <= args["max-size"].as<int>(); size *= 2) {
+            for (auto&& pattern : patterns) {
+                if (pattern == "soup") {
+                    for (double d : densities) {
+                        cases.push_back({pattern, d, size});
+                    }
+                } else {
+                    cases.push_back({pattern, 0.0, size});
+                }
+            }
+        }
+
+        const double budget = args["budget"].as<double>();
+        const auto max_gens = args["max-generations"].as<std::int64_t>();
+        const int check_size = args["check-size"].as<int>();
+        const auto check_gens = args["check-generations"].as<std::int64_t>();
+        const unsigned seed = args["seed"].as<unsigned>();
+
+        std::vector<Result> results;
+        bool failed = false;
+        for (gol::Kernel k : {gol::Kernel::SSE2, gol::Kernel::AVX2, gol::Kernel::AVX512}) {
+            // a few AVX-512 vectors and a ragged tail cover every code path;
+            // wider boards only make the scalar reference take longer
+            const int size = std::min(check_size, 64);
+            const std::string check = gol::kernel_supported(k) ? KernelCheck(k, size, check_gens, seed) : "unsupported";
+            failed = failed || check == "MISMATCH";
+            std::fprintf(stderr, "kernel %-6s %s\n", gol::kernel_name(k), check.c_str());
+        }
+        for (auto&& c : cases) {
+            const gol::Board start = MakeBoard(c, seed);
+            const double cells = static_cast<double>(c.size) * static_cast<double>(c.size);
+            const auto gens = std::clamp<std::int64_t>(static_cast<std::int64_t>(budget / cells), 1, max_gens);
+            for (auto&& name : engines) {
+                auto engine = gol::make_engine(name, pool.get());
+                if (!engine) {
+                    std::cerr << "unknown engine: " << name << std::endl;
+                    return 1;
+                }
+                engine->load(start);
+                const auto begin = Clock::now();
+                engine->step(gens);
+                const double secs = std::chrono::duration<double>(Clock::now() - begin).count();
+
+                Result r;
+                r.engine = name;
+                r.c = c;
+                r.generations = gens;
+                r.seconds = secs;
+                r.ns_per_cell = secs * 1e9 / (cells * static_cast<double>(gens));
+                r.gens_per_sec = secs > 0 ? static_cast<double>(gens) / secs : 0.0;
+                r.peak_rss_kib = PeakRssKib();
+                r.check = c.size <= check_size ? CrossCheck(name, pool.get(), start, check_gens) : "skipped";
+                failed = failed || r.check == "MISMATCH";
+                std::fprintf(stderr, "%-9s %-6s %4.2f %6d  %8lld gens  %10.4f ns/cell  %10.1f gens/s  %8ld KiB  %s\n",
+                        r.engine.c_str(), c.pattern.c_str(), c.density, c.size, static_cast<long long>(gens),
+                        r.ns_per_cell, r.gens_per_sec, r.peak_rss_kib, r.check.c_str());
+                results.push_back(std::move(r));
+            }
+        }
+
+        std::ofstream file;
+        if (args.count("output")) {
+            file.open(args["output"].as<std::string>());
+            if (!file) {
+                std::cerr << "cannot open " << args["output"].as<std::string>() << std::endl;
+                return 1;
+            }
+        }
+        std::ostream& os = args.count("output") ? file : std::cout;
+        if (args["format"].as<std::string>() == "json") {
+            WriteJson(os, results);
+        } else {
+            WriteCsv(os, results);
+        }
+        return failed ? 2 : 0;
+    } catch (const std::exception& e) {
+        std::cerr << "error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,282 @@
+#include "bitboard.h"
+#include "golife.h"
+#include "metrics.h"
+#include "thread_pool.h"
+#include <cassert>
+#include <algorithm>
+
+namespace gol {
+
+namespace {
+
+constexpr int words_for(int ncols) noexcept
+{
+    return (ncols + 63) / 64;
+}
+
+constexpr std::uint64_t bit(int x) noexcept
+{
+    return std::uint64_t{1} << (x % 64);
+}
+
+// Mask of the valid cells in the last word of a row.
+constexpr std::uint64_t tail_mask(int ncols) noexcept
+{
+    return ncols % 64 == 0 ? ~std::uint64_t{0} : (std::uint64_t{1} << (ncols % 64)) - 1;
+}
+
+template <class R>
+struct FixedStep
+{
+    std::uint64_t operator()(std::uint64_t nw, std::uint64_t n, std::uint64_t ne,
+                             std::uint64_t w,  std::uint64_t c, std::uint64_t e,
+                             std::uint64_t sw, std::uint64_t s, std::uint64_t se) const noexcept
+    {
+        return bits::step<R>(nw, n, ne, w, c, e, sw, s, se);
+    }
+};
+
+struct RuleStep
+{
+    Rule rule;
+
+    std::uint64_t operator()(std::uint64_t nw, std::uint64_t n, std::uint64_t ne,
+                             std::uint64_t w,  std::uint64_t c, std::uint64_t e,
+                             std::uint64_t sw, std::uint64_t s, std::uint64_t se) const noexcept
+    {
+        return bits::step(rule, nw, n, ne, w, c, e, sw, s, se);
+    }
+};
+
+template <class Step>
+void tick_words(const BitBoardView& b, BitBoard& next, int y0, int y1, int w0, int w1, Step step) noexcept
+{
+    const std::uint64_t* const src = b.words;
+    std::uint64_t* const dst = next.words.data();
+    const std::uint64_t last = tail_mask(b.ncols);
+    for (int y = y0; y < y1; ++y) {
+        const std::uint64_t* up   = y > 0           ? src + (y - 1)*b.nwords : nullptr;
+        const std::uint64_t* cur  = src + y*b.nwords;
+        const std::uint64_t* down = y + 1 < b.nrows ? src + (y + 1)*b.nwords : nullptr;
+        std::uint64_t* out = dst + y*b.nwords;
+
+        // sliding window of (previous, current, next) words for each row
+        const bool first = w0 == 0;
+        std::uint64_t u0 = up   && !first ? up[w0 - 1]   : 0, u1 = up   ? up[w0]   : 0;
+        std::uint64_t c0 =         !first ? cur[w0 - 1]  : 0, c1 = cur[w0];
+        std::uint64_t d0 = down && !first ? down[w0 - 1] : 0, d1 = down ? down[w0] : 0;
+        for (int i = w0; i < w1; ++i) {
+            const bool more = i + 1 < b.nwords;
+            const std::uint64_t u2 = up   && more ? up[i + 1]   : 0;
+            const std::uint64_t c2 = more         ? cur[i + 1]  : 0;
+            const std::uint64_t d2 = down && more ? down[i + 1] : 0;
+            out[i] = step(
+                    bits::west(u0, u1), u1, bits::east(u1, u2),
+                    bits::west(c0, c1), c1, bits::east(c1, c2),
+                    bits::west(d0, d1), d1, bits::east(d1, d2));
+            u0 = u1; u1 = u2;
+            c0 = c1; c1 = c2;
+            d0 = d1; d1 = d2;
+        }
+        if (w1 == b.nwords) {
+            out[b.nwords - 1] &= last;
+        }
+    }
+}
+
+// Compute rows [y0, y1) and words [w0, w1) of each of those rows.
+void tick_region(const BitBoardView& b, BitBoard& next, int y0, int y1, int w0, int w1, Rule rule) noexcept
+{
+    assert(next.nrows == b.nrows && next.ncols == b.ncols);
+    assert(0 <= y0 && y0 <= y1 && y1 <= b.nrows);
+    assert(0 <= w0 && w0 <= w1 && w1 <= b.nwords);
+    if (w0 == w1) {
+        return;
+    }
+    const bool fixed = with_fixed_rule(rule, [&](auto r) {
+        tick_words(b, next, y0, y1, w0, w1, FixedStep<decltype(r)>{});
+    });
+    if (!fixed) {
+        tick_words(b, next, y0, y1, w0, w1, RuleStep{rule});
+    }
+}
+
+} // namespace
+
+bool BitBoardView::live(int x, int y) const noexcept
+{
+    assert(0 <= x && x < ncols);
+    assert(0 <= y && y < nrows);
+    return (words[y*nwords + x/64] & bit(x)) != 0;
+}
+
+void BitBoardView::tick_into(BitBoard& next, Rule rule) const noexcept
+{
+    assert(next.words.data() != words || words == nullptr);
+    if (next.nrows != nrows || next.ncols != ncols) {
+        next = BitBoard(nrows, ncols);
+    }
+    tick_region(*this, next, 0, nrows, 0, nwords, rule);
+    count_generation();
+    count_cells(static_cast<std::uint64_t>(nrows)*static_cast<std::uint64_t>(ncols));
+}
+
+void BitBoardView::tick_into(BitBoard& next, ThreadPool& pool, Rule rule) const noexcept
+{
+    assert(next.words.data() != words || words == nullptr);
+    if (next.nrows != nrows || next.ncols != ncols) {
+        next = BitBoard(nrows, ncols);
+    }
+    parallel_rows(pool, nrows, [&](int y0, int y1) {
+        tick_region(*this, next, y0, y1, 0, nwords, rule);
+        count_cells(static_cast<std::uint64_t>(y1 - y0)*static_cast<std::uint64_t>(ncols));
+    });
+    count_generation();
+}
+
+std::int64_t BitBoardView::population() const noexcept
+{
+    std::int64_t result = 0;
+    const std::size_t n = static_cast<std::size_t>(nrows)*static_cast<std::size_t>(nwords);
+    for (std::size_t i = 0; i < n; ++i) {
+        result += __builtin_popcountll(words[i]);
+    }
+    return result;
+}
+
+BitBoard BitBoardView::to_bitboard() const
+{
+    BitBoard b(nrows, ncols);
+    std::copy_n(words, b.words.size(), b.words.begin());
+    return b;
+}
+
+Board BitBoardView::to_board() const
+{
+    Board b(nrows, ncols);
+    for (int y = 0; y < nrows; ++y) {
+        for (int x = 0; x < ncols; ++x) {
+            if (live(x, y)) {
+                b.set_live(x, y);
+            }
+        }
+    }
+    return b;
+}
+
+BitBoard::BitBoard(int xs, int ys) noexcept
+    : nrows{xs}, ncols{ys}, nwords{words_for(ys)}, words(nrows * nwords, 0) {}
+
+BitBoard::BitBoard(const Board& b) noexcept
+    : BitBoard(b.nrows, b.ncols)
+{
+    for (int y = 0; y < nrows; ++y) {
+        for (int x = 0; x < ncols; ++x) {
+            if (b.live(x, y)) {
+                set_live(x, y);
+            }
+        }
+    }
+}
+
+bool BitBoard::live(int x, int y) const noexcept
+{
+    assert(0 <= x && x < ncols);
+    assert(0 <= y && y < nrows);
+    return (words[y*nwords + x/64] & bit(x)) != 0;
+}
+
+bool BitBoard::dead(int x, int y) const noexcept
+{
+    return !live(x, y);
+}
+
+void BitBoard::set_live(int x, int y) noexcept
+{
+    assert(0 <= x && x < ncols);
+    assert(0 <= y && y < nrows);
+    words[y*nwords + x/64] |= bit(x);
+}
+
+void BitBoard::set_dead(int x, int y) noexcept
+{
+    assert(0 <= x && x < ncols);
+    assert(0 <= y && y < nrows);
+    words[y*nwords + x/64] &= ~bit(x);
+}
+
+void BitBoard::flip_state(int x, int y) noexcept
+{
+    assert(0 <= x && x < ncols);
+    assert(0 <= y && y < nrows);
+    words[y*nwords + x/64] ^= bit(x);
+}
+
+BitBoard BitBoard::tick(Rule rule) const noexcept
+{
+    BitBoard nb;
+    tick_into(nb, rule);
+    return nb;
+}
+
+BitBoard BitBoard::tick(ThreadPool& pool, Rule rule) const noexcept
+{
+    BitBoard nb;
+    tick_into(nb, pool, rule);
+    return nb;
+}
+
+void BitBoard::tick_into(BitBoard& next, Rule rule) const noexcept
+{
+    assert(&next != this);
+    view().tick_into(next, rule);
+}
+
+void BitBoard::tick_into(BitBoard& next, ThreadPool& pool, Rule rule) const noexcept
+{
+    assert(&next != this);
+    view().tick_into(next, pool, rule);
+}
+
+void BitBoard::tick_rows(BitBoard& next, int y0, int y1, Rule rule) const noexcept
+{
+    tick_region(next, y0, y1, 0, nwords, rule);
+}
+
+void BitBoard::tick_region(BitBoard& next, int y0, int y1, int w0, int w1, Rule rule) const noexcept
+{
+    gol::tick_region(view(), next, y0, y1, w0, w1, rule);
+}
+
+bool BitBoard::empty() const noexcept
+{
+    return std::all_of(words.begin(), words.end(), [](std::uint64_t w) { return w == 0; });
+}
+
+std::int64_t BitBoard::population() const noexcept
+{
+    return view().population();
+}
+
+Board BitBoard::to_board() const
+{
+    return view().to_board();
+}
+
+bool operator==(const BitBoard& lhs, const BitBoard& rhs) noexcept
+{
+    if (lhs.nrows != rhs.nrows) {
+        return false;
+    }
+    if (lhs.ncols != rhs.ncols) {
+        return false;
+    }
+    return lhs.words == rhs.words;
+}
+
+bool operator!=(const BitBoard& lhs, const BitBoard& rhs) noexcept
+{
+    return !(lhs == rhs);
+}
+
+} // namespace gol
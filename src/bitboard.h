@@ -0,0 +1,196 @@
+#pragma once
+
+#include "rule.h"
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace gol {
+
+struct Board;
+struct BitBoard;
+class ThreadPool;
+
+// Read-only cells in the BitBoard layout kept somewhere else, such as a
+// mapped checkpoint file.  Ticking a view writes an ordinary BitBoard, so
+// a board can be resumed straight from the file without copying it.
+struct BitBoardView
+{
+    bool live(int x, int y) const noexcept;
+    void tick_into(BitBoard& next, Rule rule = {}) const noexcept;
+    void tick_into(BitBoard& next, ThreadPool& pool, Rule rule = {}) const noexcept;
+    std::int64_t population() const noexcept;
+    BitBoard to_bitboard() const;
+    Board to_board() const;
+
+    int nrows = {};
+    int ncols = {};
+    int nwords = {};
+    const std::uint64_t* words = nullptr;
+};
+
+// Bit-packed board: 64 cells per word, row-major.  Cell (x, y) lives in
+// bit (x % 64) of words[y*nwords + x/64].  Bits past `ncols` in the last
+// word of each row are always kept clear.
+struct BitBoard
+{
+    BitBoard() noexcept = default;
+    BitBoard(int nrows, int ncols) noexcept;
+    explicit BitBoard(const Board& b) noexcept;
+    bool live(int x, int y) const noexcept;
+    bool dead(int x, int y) const noexcept;
+    void set_live(int x, int y) noexcept;
+    void set_dead(int x, int y) noexcept;
+    void flip_state(int x, int y) noexcept;
+    BitBoard tick(Rule rule = {}) const noexcept;
+    BitBoard tick(ThreadPool& pool, Rule rule = {}) const noexcept;
+    void tick_into(BitBoard& next, Rule rule = {}) const noexcept;
+    void tick_into(BitBoard& next, ThreadPool& pool, Rule rule = {}) const noexcept;
+    void tick_rows(BitBoard& next, int y0, int y1, Rule rule = {}) const noexcept;
+    void tick_region(BitBoard& next, int y0, int y1, int w0, int w1, Rule rule = {}) const noexcept;
+    bool empty() const noexcept;
+    std::int64_t population() const noexcept;
+    Board to_board() const;
+    BitBoardView view() const noexcept { return {nrows, ncols, nwords, words.data()}; }
+
+    int nrows = {};
+    int ncols = {};
+    int nwords = {};
+    std::vector<std::uint64_t> words = {};
+
+private:
+    friend bool operator==(const BitBoard& lhs, const BitBoard& rhs) noexcept;
+    friend bool operator!=(const BitBoard& lhs, const BitBoard& rhs) noexcept;
+};
+
+namespace bits {
+
+// Neighbour row shifted so that bit i holds the cell to the west (east) of
+// cell i, pulling the edge bit in from the adjacent word.
+inline std::uint64_t west(std::uint64_t prev, std::uint64_t cur) noexcept
+{
+    return (cur << 1) | (prev >> 63);
+}
+
+inline std::uint64_t east(std::uint64_t cur, std::uint64_t next) noexcept
+{
+    return (cur >> 1) | (next << 63);
+}
+
+// B3/S23 for 64 cells at once.  Each argument is a row of neighbours
+// already aligned with the centre word `c`; the eight neighbour counts are
+// summed with bit-sliced full adders.  W is std::uint64_t or a GCC vector
+// of them, which steps several independent words in one go.
+template <class W>
+inline W life(W nw, W n, W ne, W w, W c, W e, W sw, W s, W se) noexcept
+{
+    // top and bottom rows: 3 inputs -> (ones, twos)
+    const W t1 = nw ^ n ^ ne;
+    const W t2 = (nw & n) | (ne & (nw ^ n));
+    const W b1 = sw ^ s ^ se;
+    const W b2 = (sw & s) | (se & (sw ^ s));
+    // middle row: 2 inputs -> (ones, twos)
+    const W m1 = w ^ e;
+    const W m2 = w & e;
+    // ones column, carrying into the twos
+    const W ones = t1 ^ b1 ^ m1;
+    const W c2 = (t1 & b1) | (m1 & (t1 ^ b1));
+    // the count is 2 or 3 iff exactly one of the four twos is set
+    const W odd = t2 ^ b2 ^ m2 ^ c2;
+    const W pairs = (t2 & b2) | (m2 & c2) | ((t2 ^ b2) & (m2 ^ c2));
+    return odd & ~pairs & (ones | c);
+}
+
+// Neighbour counts as bit planes: cell i has b0 + 2*b1 + 4*b2 + 8*b3
+// live neighbours (bit i of each plane).
+template <class W>
+struct Count
+{
+    W b0, b1, b2, b3;
+};
+
+template <class W>
+inline Count<W> count(W nw, W n, W ne, W w, W e, W sw, W s, W se) noexcept
+{
+    // as in life(), then the four twos are added into b1..b3
+    const W t1 = nw ^ n ^ ne;
+    const W t2 = (nw & n) | (ne & (nw ^ n));
+    const W b1 = sw ^ s ^ se;
+    const W b2 = (sw & s) | (se & (sw ^ s));
+    const W m1 = w ^ e;
+    const W m2 = w & e;
+    const W c2 = (t1 & b1) | (m1 & (t1 ^ b1));
+    const W p = t2 ^ b2;
+    const W q = m2 ^ c2;
+    const W pc = t2 & b2;
+    const W qc = m2 & c2;
+    return {t1 ^ b1 ^ m1, p ^ q, pc ^ qc ^ (p & q), pc & qc};
+}
+
+// Cells whose count is exactly n, for n < 8.  A count of 8 is just b3.
+template <class W>
+inline W count_is(const Count<W>& k, int n) noexcept
+{
+    return (n & 1 ? k.b0 : ~k.b0) & (n & 2 ? k.b1 : ~k.b1) & (n & 4 ? k.b2 : ~k.b2) & ~k.b3;
+}
+
+// Any B/S rule with centre word `c`.  The masks are the same for every
+// word, so the branches on them predict perfectly.
+template <class W>
+inline W apply(const Count<W>& k, W c, std::uint16_t birth, std::uint16_t survive) noexcept
+{
+    W born = (birth >> 8) & 1 ? k.b3 : W{};
+    W stay = (survive >> 8) & 1 ? k.b3 : W{};
+    for (int n = 0; n < 8; ++n) {
+        if (((birth | survive) >> n) & 1) {
+            const W m = count_is(k, n);
+            if ((birth >> n) & 1) {
+                born |= m;
+            }
+            if ((survive >> n) & 1) {
+                stay |= m;
+            }
+        }
+    }
+    return (born & ~c) | (stay & c);
+}
+
+// The same with the masks as template arguments, unrolled so only the
+// counts the rule names are ever compared.
+template <unsigned Mask, class W, int... N>
+inline W count_in(const Count<W>& k, std::integer_sequence<int, N...>) noexcept
+{
+    return (((Mask >> 8) & 1 ? k.b3 : W{}) | ... | ((Mask >> N) & 1 ? count_is(k, N) : W{}));
+}
+
+template <std::uint16_t Birth, std::uint16_t Survive, class W>
+inline W apply(const Count<W>& k, W c) noexcept
+{
+    const auto counts = std::make_integer_sequence<int, 8>{};
+    return (count_in<Birth>(k, counts) & ~c) | (count_in<Survive>(k, counts) & c);
+}
+
+// One step of the nine aligned words under rule R, a FixedRule: B3/S23
+// keeps the dedicated adder network of life(), other rules the unrolled
+// apply().
+template <class R, class W>
+inline W step(W nw, W n, W ne, W w, W c, W e, W sw, W s, W se) noexcept
+{
+    if constexpr (std::is_same_v<R, ConwayRule>) {
+        return life(nw, n, ne, w, c, e, sw, s, se);
+    } else {
+        return apply<R::birth, R::survive>(count(nw, n, ne, w, e, sw, s, se), c);
+    }
+}
+
+// A rule only known at run time.
+template <class W>
+inline W step(Rule rule, W nw, W n, W ne, W w, W c, W e, W sw, W s, W se) noexcept
+{
+    return apply(count(nw, n, ne, w, e, sw, s, se), c, rule.birth, rule.survive);
+}
+
+} // namespace bits
+
+} // namespace gol
@@ -0,0 +1,242 @@
+#include "checkpoint.h"
+#include "history.h"
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+namespace gol {
+
+namespace {
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "checkpoints are written in host byte order");
+
+constexpr char MAGIC[8] = {'G', 'O', 'L', 'C', 'K', 'P', 'T', '\0'};
+constexpr std::uint64_t CELLS_ALIGN = 64;
+
+struct Header
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t header_size;
+    std::int32_t nrows;
+    std::int32_t ncols;
+    std::uint64_t generation;
+    std::uint16_t birth;
+    std::uint16_t survive;
+    std::uint32_t topology; // Topology
+    std::uint64_t cells_offset;
+    std::uint64_t history_offset; // 0 without a history
+    std::uint64_t history_size;
+    std::uint64_t hashes_offset; // 0 without hashes
+    std::uint64_t hashes_size;
+};
+static_assert(sizeof(Header) == 80);
+
+std::uint64_t cell_bytes(int nrows, int ncols) noexcept
+{
+    const auto nwords = static_cast<std::uint64_t>((ncols + 63) / 64);
+    return static_cast<std::uint64_t>(nrows)*nwords*sizeof(std::uint64_t);
+}
+
+[[noreturn]] void bad_checkpoint(const std::string& path, const std::string& what)
+{
+    throw std::runtime_error("checkpoint: " + path + " " + what);
+}
+
+} // namespace
+
+// Only the header is read here; the cells are left to be paged in by
+// whatever ticks them.
+Checkpoint::Checkpoint(const std::string& path)
+    : file{path}
+{
+    Header h;
+    if (file.size() < sizeof h) {
+        bad_checkpoint(path, "is too short");
+    }
+    std::memcpy(&h, file.data(), sizeof h);
+    if (std::memcmp(h.magic, MAGIC, sizeof MAGIC) != 0) {
+        bad_checkpoint(path, "is not a checkpoint");
+    }
+    if (h.version != VERSION || h.header_size != sizeof h) {
+        bad_checkpoint(path, "has unsupported version " + std::to_string(h.version));
+    }
+    const std::uint64_t size = file.size();
+    const std::uint64_t nwords = h.ncols >= 0 ? static_cast<std::uint64_t>((h.ncols + 63) / 64) : 0;
+    if (h.nrows < 0 || h.ncols < 0 || static_cast<std::uint64_t>(h.nrows)*nwords > INT_MAX) {
+        bad_checkpoint(path, "has a bad board size");
+    }
+    const std::uint64_t ncell_bytes = cell_bytes(h.nrows, h.ncols);
+    if (h.cells_offset < sizeof h || h.cells_offset % sizeof(std::uint64_t) != 0
+            || h.cells_offset > size || ncell_bytes > size - h.cells_offset) {
+        bad_checkpoint(path, "is truncated");
+    }
+    if (h.topology > static_cast<std::uint32_t>(Topology::KleinBottle)) {
+        bad_checkpoint(path, "has an unknown topology");
+    }
+    if (h.history_size != 0 && (h.history_offset > size || h.history_size > size - h.history_offset)) {
+        bad_checkpoint(path, "is truncated");
+    }
+    if (h.hashes_size % sizeof(std::uint64_t) != 0
+            || (h.hashes_size != 0 && (h.hashes_offset > size || h.hashes_size > size - h.hashes_offset))) {
+        bad_checkpoint(path, "is truncated");
+    }
+    rows = h.nrows;
+    cols = h.ncols;
+    gen = h.generation;
+    life_rule = Rule{h.birth, h.survive};
+    topo = static_cast<Topology>(h.topology);
+    cells_offset = h.cells_offset;
+    history_offset = h.history_offset;
+    history_size = h.history_size;
+    hashes_offset = h.hashes_offset;
+    hashes_size = h.hashes_size;
+}
+
+BitBoardView Checkpoint::cells() const noexcept
+{
+    const char* p = file.data() + cells_offset;
+    return {rows, cols, (cols + 63) / 64, reinterpret_cast<const std::uint64_t*>(p)};
+}
+
+History Checkpoint::history() const
+{
+    if (!has_history()) {
+        throw std::runtime_error("checkpoint: no history saved");
+    }
+    return History::read(file.data() + history_offset, history_size, life_rule);
+}
+
+std::vector<std::uint64_t> Checkpoint::hashes() const
+{
+    std::vector<std::uint64_t> result(hashes_size / sizeof(std::uint64_t));
+    if (!result.empty()) {
+        std::memcpy(result.data(), file.data() + hashes_offset, hashes_size);
+    }
+    return result;
+}
+
+void save_checkpoint(const std::string& path, BitBoardView cells, std::uint64_t generation,
+                     Rule rule, Topology topology, const History* history, const std::vector<std::uint64_t>* hashes)
+{
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream os(tmp, std::ios::binary);
+        if (!os) {
+            throw std::runtime_error("cannot open output file: " + tmp);
+        }
+        Header h = {};
+        std::memcpy(h.magic, MAGIC, sizeof MAGIC);
+        h.version = Checkpoint::VERSION;
+        h.header_size = sizeof h;
+        h.nrows = cells.nrows;
+        h.ncols = cells.ncols;
+        h.generation = generation;
+        h.birth = rule.birth;
+        h.survive = rule.survive;
+        h.topology = static_cast<std::uint32_t>(topology);
+        h.cells_offset = (sizeof h + CELLS_ALIGN - 1) / CELLS_ALIGN * CELLS_ALIGN;
+        const std::uint64_t nbytes = cell_bytes(cells.nrows, cells.ncols);
+
+        os.write(reinterpret_cast<const char*>(&h), sizeof h);
+        const char zeros[CELLS_ALIGN] = {};
+        os.write(zeros, static_cast<std::streamsize>(h.cells_offset - sizeof h));
+        os.write(reinterpret_cast<const char*>(cells.words), static_cast<std::streamsize>(nbytes));
+        if (history) {
+            h.history_offset = h.cells_offset + nbytes;
+            history->write(os);
+            h.history_size = static_cast<std::uint64_t>(os.tellp()) - h.history_offset;
+        }
+        if (hashes && !hashes->empty()) {
+            h.hashes_offset = static_cast<std::uint64_t>(os.tellp());
+            h.hashes_size = hashes->size()*sizeof(std::uint64_t);
+            os.write(reinterpret_cast<const char*>(hashes->data()), static_cast<std::streamsize>(h.hashes_size));
+        }
+        if (h.history_size != 0 || h.hashes_size != 0) {
+            os.seekp(0);
+            os.write(reinterpret_cast<const char*>(&h), sizeof h);
+        }
+        if (!os.flush()) {
+            throw std::runtime_error("error writing " + tmp);
+        }
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("cannot rename " + tmp + " to " + path);
+    }
+}
+
+CheckpointWriter::CheckpointWriter(std::string path)
+    : target{std::move(path)}
+    , worker([this] { run(); })
+{
+}
+
+CheckpointWriter::~CheckpointWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    wake_cv.notify_all();
+    worker.join();
+}
+
+// The lock is only there so the writer cannot miss the wakeup; it never
+// holds it while writing.
+void CheckpointWriter::submit(std::uint64_t generation, Rule rule, Topology topology)
+{
+    Pending& p = pending.back();
+    p.generation = generation;
+    p.rule = rule;
+    p.topology = topology;
+    p.serial = ++submitted;
+    pending.publish();
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+    }
+    wake_cv.notify_one();
+}
+
+void CheckpointWriter::flush()
+{
+    std::unique_lock<std::mutex> lock(mtx);
+    done_cv.wait(lock, [this] { return done == submitted; });
+    if (error) {
+        std::rethrow_exception(std::exchange(error, nullptr));
+    }
+}
+
+void CheckpointWriter::run()
+{
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            wake_cv.wait(lock, [this] { return stopping || !pending.consumed(); });
+            if (pending.consumed()) {
+                return;
+            }
+        }
+        pending.update();
+        const Pending& p = pending.front();
+        std::exception_ptr failed;
+        try {
+            save_checkpoint(target, p.board.view(), p.generation, p.rule, p.topology);
+            nwritten.fetch_add(1, std::memory_order_relaxed);
+        } catch (...) {
+            failed = std::current_exception();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (failed && !error) {
+                error = failed;
+            }
+            done = p.serial;
+        }
+        done_cv.notify_all();
+    }
+}
+
+} // namespace gol
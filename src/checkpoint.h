@@ -0,0 +1,120 @@
+#pragma once
+
+#include "bitboard.h"
+#include "halo.h"
+#include "mapped_file.h"
+#include "rule.h"
+#include "triple_buffer.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace gol {
+
+class History;
+
+// Binary checkpoint of a run.  An 80-byte little-endian header (magic,
+// version, dimensions, generation, rule, topology, section offsets)
+// is followed by the cells in the BitBoard layout, 64-byte aligned, and
+// optionally by the History in its own binary form and the Zobrist hash
+// of each generation in it.
+//
+// Opening one maps the file and checks the header; cells() then points
+// straight into the mapping, so resuming even a very large board reads
+// only the pages its first generation touches.
+class Checkpoint
+{
+public:
+    static constexpr std::uint32_t VERSION = 2;
+
+    // Throws std::runtime_error if the file cannot be mapped or is not a
+    // checkpoint this version can read.
+    explicit Checkpoint(const std::string& path);
+
+    int nrows() const noexcept { return rows; }
+    int ncols() const noexcept { return cols; }
+    std::uint64_t generation() const noexcept { return gen; }
+    Rule rule() const noexcept { return life_rule; }
+    Topology topology() const noexcept { return topo; }
+    // Valid for as long as this Checkpoint is.
+    BitBoardView cells() const noexcept;
+
+    bool has_history() const noexcept { return history_size != 0; }
+    // Under rule().  Throws std::runtime_error without a history or for a
+    // malformed one.
+    History history() const;
+    // One per generation of history(), or none if they were not saved.
+    std::vector<std::uint64_t> hashes() const;
+
+private:
+    MappedFile file;
+    int rows = 0;
+    int cols = 0;
+    std::uint64_t gen = 0;
+    Rule life_rule = {};
+    Topology topo = Topology::Bounded;
+    std::uint64_t cells_offset = 0;
+    std::uint64_t history_offset = 0;
+    std::uint64_t history_size = 0;
+    std::uint64_t hashes_offset = 0;
+    std::uint64_t hashes_size = 0;
+};
+
+// Written to `path` + ".tmp" and renamed over `path` once complete, so a
+// process killed mid-write leaves the previous checkpoint intact.  Throws
+// std::runtime_error on failure.
+void save_checkpoint(const std::string& path, BitBoardView cells, std::uint64_t generation,
+                     Rule rule, Topology topology = Topology::Bounded, const History* history = nullptr,
+                     const std::vector<std::uint64_t>* hashes = nullptr);
+
+// Writes checkpoints on its own thread.  The simulation fills board() and
+// calls submit(), which costs it one board copy and never waits for the
+// disk: if the previous checkpoint is still being written, the next one
+// replaces whatever was waiting, so only the newest state is kept.
+class CheckpointWriter
+{
+public:
+    explicit CheckpointWriter(std::string path);
+    // Writes whatever is still waiting.
+    ~CheckpointWriter();
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    BitBoard& board() noexcept { return pending.back().board; }
+    void submit(std::uint64_t generation, Rule rule, Topology topology = Topology::Bounded);
+    // Wait for the last submitted checkpoint to be on disk, and rethrow
+    // the first error the writer thread ran into.
+    void flush();
+    std::uint64_t written() const noexcept { return nwritten.load(std::memory_order_relaxed); }
+
+private:
+    struct Pending
+    {
+        BitBoard board;
+        std::uint64_t generation = 0;
+        Rule rule = {};
+        Topology topology = Topology::Bounded;
+        std::uint64_t serial = 0;
+    };
+
+    void run();
+
+    std::string target;
+    TripleBuffer<Pending> pending;
+    std::uint64_t submitted = 0; // simulation thread only
+    std::atomic<std::uint64_t> nwritten{0};
+    std::mutex mtx; // only for waking and flush()
+    std::condition_variable wake_cv;
+    std::condition_variable done_cv;
+    std::uint64_t done = 0; // serial of the last one written, under mtx
+    bool stopping = false;
+    std::exception_ptr error;
+    std::thread worker;
+};
+
+} // namespace gol
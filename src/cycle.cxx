@@ -0,0 +1,77 @@
+#include "cycle.h"
+#include "golife.h"
+#include <utility>
+
+namespace gol {
+
+namespace {
+
+std::uint64_t splitmix64(std::uint64_t& state) noexcept
+{
+    std::uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+} // namespace
+
+Zobrist::Zobrist(std::size_t ncells, std::uint64_t seed)
+    : keys(ncells)
+{
+    for (auto& k : keys) {
+        k = splitmix64(seed);
+    }
+}
+
+std::uint64_t Zobrist::hash(const Board& b) const noexcept
+{
+    std::uint64_t h = 0;
+    for (std::size_t i = 0; i < b.brd.size(); ++i) {
+        if (b.brd[i] == Board::LIVE) {
+            h ^= keys[i];
+        }
+    }
+    return h;
+}
+
+std::uint64_t Zobrist::update(std::uint64_t h, const std::vector<std::uint32_t>& flips) const noexcept
+{
+    for (std::uint32_t cell : flips) {
+        h ^= keys[cell];
+    }
+    return h;
+}
+
+void CycleDetector::reset() noexcept
+{
+    hashes.clear();
+    seen.clear();
+}
+
+void CycleDetector::assign(std::vector<std::uint64_t> recorded)
+{
+    hashes = std::move(recorded);
+    seen.clear();
+    seen.reserve(hashes.size());
+    for (std::size_t gen = 0; gen < hashes.size(); ++gen) {
+        seen.emplace(hashes[gen], gen);
+    }
+}
+
+void CycleDetector::truncate(std::size_t ngenerations)
+{
+    while (hashes.size() > ngenerations) {
+        const std::size_t gen = hashes.size() - 1;
+        auto [first, last] = seen.equal_range(hashes.back());
+        for (auto it = first; it != last; ++it) {
+            if (it->second == gen) {
+                seen.erase(it);
+                break;
+            }
+        }
+        hashes.pop_back();
+    }
+}
+
+} // namespace gol
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace gol {
+
+struct Board;
+
+// Zobrist hashing: every cell index gets a random 64-bit key and a board
+// hashes to the XOR of the keys of its live cells.  The hash of the next
+// generation then follows from the cells that flipped, without rescanning
+// the board.
+class Zobrist
+{
+public:
+    Zobrist() = default;
+    explicit Zobrist(std::size_t ncells, std::uint64_t seed = 0x2545f4914f6cdd1dull);
+
+    std::size_t size() const noexcept { return keys.size(); }
+    std::uint64_t key(std::size_t cell) const noexcept { return keys[cell]; }
+    std::uint64_t hash(const Board& b) const noexcept;
+    std::uint64_t update(std::uint64_t h, const std::vector<std::uint32_t>& flips) const noexcept;
+
+private:
+    std::vector<std::uint64_t> keys;
+};
+
+struct Cycle
+{
+    std::size_t start;  // first generation of the repeating part
+    std::size_t period;
+};
+
+// Remembers the hash of every generation seen so far.  A repeated hash is
+// only reported as a cycle once a full comparison confirms the boards are
+// equal, so hash collisions cost a comparison but never a false result.
+class CycleDetector
+{
+public:
+    void reset() noexcept;
+    std::size_t size() const noexcept { return hashes.size(); }
+    std::uint64_t last_hash() const noexcept { return hashes.back(); }
+    // The hash of every generation recorded so far, oldest first.
+    const std::vector<std::uint64_t>& recorded() const noexcept { return hashes; }
+    // Start over from hashes recorded earlier; nothing is confirmed, so no
+    // cycle is reported for them.
+    void assign(std::vector<std::uint64_t> recorded);
+
+    // Record the hash of generation size().  For each earlier generation g
+    // with the same hash, same(g) must say whether its board equals the new
+    // one; the earliest confirmed g starts the reported cycle.
+    template <class Same>
+    std::optional<Cycle> observe(std::uint64_t hash, Same&& same)
+    {
+        const std::size_t gen = hashes.size();
+        std::optional<Cycle> result;
+        auto [first, last] = seen.equal_range(hash);
+        for (auto it = first; it != last; ++it) {
+            const std::size_t g = it->second;
+            if ((!result || g < result->start) && same(g)) {
+                result = Cycle{g, gen - g};
+            }
+        }
+        hashes.push_back(hash);
+        seen.emplace(hash, gen);
+        return result;
+    }
+
+    // Forget generations [ngenerations, size()).
+    void truncate(std::size_t ngenerations);
+
+private:
+    std::vector<std::uint64_t> hashes;
+    std::unordered_multimap<std::uint64_t, std::size_t> seen;
+};
+
+} // namespace gol
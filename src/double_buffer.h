@@ -0,0 +1,62 @@
+#pragma once
+
+#include "rule.h"
+#include <cstdint>
+#include <utility>
+
+namespace gol {
+
+class ThreadPool;
+
+// Ping-pongs between two boards of the same size, so advancing any number
+// of generations does no heap allocation once the back buffer has been
+// sized by the first step.  Works with any board type that provides
+// tick_into(), i.e. Board and BitBoard.
+template <class B>
+class DoubleBuffer
+{
+public:
+    DoubleBuffer() = default;
+    explicit DoubleBuffer(B initial, Rule rule = {}) : front{std::move(initial)}, life_rule{rule} {}
+
+    const B& current() const noexcept { return front; }
+    B& current() noexcept { return front; }
+    // The generation before current(); only meaningful once step() has run.
+    const B& prior() const noexcept { return back; }
+    std::int64_t generation() const noexcept { return gen; }
+    Rule rule() const noexcept { return life_rule; }
+    void set_rule(Rule rule) noexcept { life_rule = rule; }
+
+    // Replace the current state and restart the generation count.
+    void reset(B initial)
+    {
+        front = std::move(initial);
+        gen = 0;
+    }
+
+    void step(std::int64_t n = 1) noexcept
+    {
+        for (std::int64_t i = 0; i < n; ++i) {
+            front.tick_into(back, life_rule);
+            std::swap(front, back);
+        }
+        gen += n;
+    }
+
+    void step(std::int64_t n, ThreadPool& pool) noexcept
+    {
+        for (std::int64_t i = 0; i < n; ++i) {
+            front.tick_into(back, pool, life_rule);
+            std::swap(front, back);
+        }
+        gen += n;
+    }
+
+private:
+    B front = {};
+    B back = {};
+    std::int64_t gen = 0;
+    Rule life_rule = {};
+};
+
+} // namespace gol
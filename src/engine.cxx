@@ -0,0 +1,318 @@
+#include "engine.h"
+#include "bitboard.h"
+#include "checkpoint.h"
+#include "double_buffer.h"
+#include "golife.h"
+#include "hashlife.h"
+#include "sparse.h"
+#include "thread_pool.h"
+#include "tiled.h"
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace gol {
+
+namespace {
+
+std::uint64_t count_live(const Board& b) noexcept
+{
+    return static_cast<std::uint64_t>(std::count(b.brd.begin(), b.brd.end(), Board::LIVE));
+}
+
+void check_topology(const Engine& engine, const Checkpoint& checkpoint)
+{
+    if (checkpoint.topology() != engine.topology()) {
+        throw std::runtime_error(std::string("checkpoint: saved on a ") + topology_name(checkpoint.topology())
+                + " board, but the " + engine.name() + " engine runs a " + topology_name(engine.topology()) + " one");
+    }
+}
+
+template <class B>
+class BufferedEngine final : public Engine
+{
+public:
+    BufferedEngine(const char* engine_name, ThreadPool* workers, Rule rule)
+        : label{engine_name}, pool{workers}, buf{B{}, rule} {}
+
+    const char* name() const noexcept override { return label; }
+
+    void load(const Board& b) override
+    {
+        mapped.reset();
+        mapped_prior.reset();
+        if constexpr (std::is_same_v<B, Board>) {
+            buf.reset(b);
+        } else {
+            buf.reset(B(b));
+        }
+    }
+
+    void restore(Checkpoint checkpoint) override
+    {
+        if constexpr (std::is_same_v<B, Board>) {
+            Engine::restore(std::move(checkpoint));
+        } else {
+            check_topology(*this, checkpoint);
+            mapped.emplace(std::move(checkpoint));
+            mapped_prior.reset();
+            buf.reset(B{});
+        }
+    }
+
+    void step(std::int64_t n) override
+    {
+        if constexpr (std::is_same_v<B, BitBoard>) {
+            if (mapped && n > 0) {
+                B next;
+                if (pool) {
+                    mapped->cells().tick_into(next, *pool, buf.rule());
+                } else {
+                    mapped->cells().tick_into(next, buf.rule());
+                }
+                buf.reset(std::move(next));
+                mapped_prior = std::move(mapped);
+                mapped.reset();
+                --n;
+            }
+            if (n > 0) {
+                mapped_prior.reset();
+            }
+        }
+        if (pool) {
+            buf.step(n, *pool);
+        } else {
+            buf.step(n);
+        }
+    }
+
+    Board board() const override
+    {
+        if constexpr (std::is_same_v<B, Board>) {
+            return buf.current();
+        } else {
+            return current().to_board();
+        }
+    }
+
+    std::uint64_t population() const override
+    {
+        if constexpr (std::is_same_v<B, Board>) {
+            return count_live(buf.current());
+        } else {
+            return static_cast<std::uint64_t>(current().population());
+        }
+    }
+
+    Activity activity() const override
+    {
+        if constexpr (std::is_same_v<B, BitBoard>) {
+            if (mapped_prior) {
+                return gol::activity(mapped_prior->cells(), buf.current().view());
+            }
+        }
+        if (mapped || buf.generation() == 0) {
+            return {static_cast<std::int64_t>(population()), 0, 0};
+        }
+        return gol::activity(buf.prior(), buf.current());
+    }
+
+    void copy_bits(BitBoard& out) const override
+    {
+        if constexpr (std::is_same_v<B, Board>) {
+            out = BitBoard(buf.current());
+        } else if (mapped) {
+            out = mapped->cells().to_bitboard();
+        } else {
+            out = buf.current();
+        }
+    }
+
+private:
+    BitBoardView current() const noexcept
+    {
+        return mapped ? mapped->cells() : buf.current().view();
+    }
+
+    const char* label;
+    ThreadPool* pool;
+    DoubleBuffer<B> buf;
+    // A restored checkpoint stays mapped while it is the current
+    // generation, and for one more step as the one before it.
+    std::optional<Checkpoint> mapped;
+    std::optional<Checkpoint> mapped_prior;
+};
+
+class HaloEngine final : public Engine
+{
+public:
+    HaloEngine(ThreadPool* workers, Rule rule, Topology topology)
+        : pool{workers}, topo{topology}, buf{HaloBoard{}, rule} {}
+
+    const char* name() const noexcept override { return "halo"; }
+    Topology topology() const noexcept override { return topo; }
+    void load(const Board& b) override { buf.reset(HaloBoard(b, topo)); }
+
+    void step(std::int64_t n) override
+    {
+        if (pool) {
+            buf.step(n, *pool);
+        } else {
+            buf.step(n);
+        }
+    }
+
+    Board board() const override { return buf.current().to_board(); }
+    std::uint64_t population() const override { return static_cast<std::uint64_t>(buf.current().population()); }
+
+    Activity activity() const override
+    {
+        if (buf.generation() == 0) {
+            return {buf.current().population(), 0, 0};
+        }
+        return gol::activity(buf.prior(), buf.current());
+    }
+
+private:
+    ThreadPool* pool;
+    Topology topo;
+    DoubleBuffer<HaloBoard> buf;
+};
+
+class TiledEngine final : public Engine
+{
+public:
+    TiledEngine(ThreadPool* workers, Rule rule) : pool{workers}, tiles{BitBoard{}, rule} {}
+
+    const char* name() const noexcept override { return "tiled"; }
+    void load(const Board& b) override { tiles = TiledBoard(b, tiles.rule()); }
+    void restore(Checkpoint checkpoint) override
+    {
+        check_topology(*this, checkpoint);
+        tiles = TiledBoard(checkpoint.cells().to_bitboard(), tiles.rule());
+    }
+
+    void step(std::int64_t n) override
+    {
+        if (pool) {
+            tiles.step(n, *pool);
+        } else {
+            tiles.step(n);
+        }
+    }
+
+    Board board() const override { return tiles.current().to_board(); }
+    std::uint64_t population() const override { return static_cast<std::uint64_t>(tiles.current().population()); }
+    Activity activity() const override { return gol::activity(tiles.prior(), tiles.current()); }
+    void copy_bits(BitBoard& out) const override { out = tiles.current(); }
+
+private:
+    ThreadPool* pool;
+    TiledBoard tiles;
+};
+
+class HashLifeEngine final : public Engine
+{
+public:
+    const char* name() const noexcept override { return "hashlife"; }
+
+    void load(const Board& b) override
+    {
+        nrows = b.nrows;
+        ncols = b.ncols;
+        life.load(b);
+    }
+
+    void step(std::int64_t n) override { life.advance(static_cast<std::uint64_t>(n)); }
+    Board board() const override { return life.to_board(nrows, ncols); }
+    std::uint64_t population() const override { return life.population(); }
+    Activity activity() const override { return {static_cast<std::int64_t>(life.population()), -1, -1}; }
+
+private:
+    int nrows = 0;
+    int ncols = 0;
+    HashLife life;
+};
+
+class SparseEngine final : public Engine
+{
+public:
+    const char* name() const noexcept override { return "sparse"; }
+
+    void load(const Board& b) override
+    {
+        nrows = b.nrows;
+        ncols = b.ncols;
+        universe = SparseUniverse(b);
+    }
+
+    void step(std::int64_t n) override { universe.step(n); }
+    Board board() const override { return universe.to_board(0, 0, nrows, ncols); }
+    std::uint64_t population() const override { return universe.population(); }
+    Activity activity() const override { return {static_cast<std::int64_t>(universe.population()), -1, -1}; }
+
+private:
+    int nrows = 0;
+    int ncols = 0;
+    SparseUniverse universe;
+};
+
+} // namespace
+
+void Engine::restore(Checkpoint checkpoint)
+{
+    check_topology(*this, checkpoint);
+    load(checkpoint.cells().to_board());
+}
+
+void Engine::copy_bits(BitBoard& out) const
+{
+    out = BitBoard(board());
+}
+
+std::unique_ptr<Engine> make_engine(const std::string& name, ThreadPool* pool, Rule rule, Topology topology)
+{
+    if (name == "halo") {
+        return std::make_unique<HaloEngine>(pool, rule, topology);
+    }
+    if (topology != Topology::Bounded) {
+        return nullptr;
+    }
+    if (name == "board") {
+        return std::make_unique<BufferedEngine<Board>>("board", pool, rule);
+    }
+    if (name == "bitboard") {
+        return std::make_unique<BufferedEngine<BitBoard>>("bitboard", pool, rule);
+    }
+    if (name == "tiled") {
+        return std::make_unique<TiledEngine>(pool, rule);
+    }
+    if (rule != CONWAY) {
+        return nullptr;
+    }
+    if (name == "hashlife") {
+        return std::make_unique<HashLifeEngine>();
+    }
+    if (name == "sparse") {
+        return std::make_unique<SparseEngine>();
+    }
+    return nullptr;
+}
+
+const std::vector<std::string>& engine_names()
+{
+    static const std::vector<std::string> names = {
+        "board",
+        "bitboard",
+        "tiled",
+        "halo",
+        "hashlife",
+        "sparse",
+    };
+    return names;
+}
+
+} // namespace gol
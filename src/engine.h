@@ -0,0 +1,55 @@
+#pragma once
+
+#include "halo.h"
+#include "metrics.h"
+#include "rule.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace gol {
+
+struct Board;
+struct BitBoard;
+class Checkpoint;
+class ThreadPool;
+
+// Common interface over the simulation engines, so tools can pick one by
+// name.  The bounded engines ("board", "bitboard", "tiled") treat cells off
+// the board as dead; "halo" does too by default, or wraps around as a
+// torus or Klein bottle.  The unbounded ones ("hashlife", "sparse") let the
+// pattern leave it, and board() only shows the original rectangle.
+class Engine
+{
+public:
+    virtual ~Engine() = default;
+    virtual const char* name() const noexcept = 0;
+    virtual void load(const Board& b) = 0;
+    virtual void step(std::int64_t n) = 0;
+    virtual Board board() const = 0;
+    virtual std::uint64_t population() const = 0;
+    // What the last generation stepped changed.  Only the bounded engines
+    // know births and deaths; the unbounded ones report just the population.
+    virtual Activity activity() const = 0;
+    virtual Topology topology() const noexcept { return Topology::Bounded; }
+    // Continue from a checkpoint as load() would from its board, under the
+    // engine's own rule.  The bitboard engine ticks its first generation
+    // straight out of the mapped file rather than unpacking it first.
+    // Throws std::runtime_error for a checkpoint saved under another
+    // topology.
+    virtual void restore(Checkpoint checkpoint);
+    // The current state bit-packed, e.g. for a CheckpointWriter.  The
+    // unbounded engines give the original rectangle, as board() does.
+    virtual void copy_bits(BitBoard& out) const;
+};
+
+// `pool` may be null; engines that can use threads run single-threaded
+// then.  Returns null for an unknown name, for "hashlife" or "sparse" with
+// any rule but B3/S23, which those two hard-code, and for a topology other
+// than Bounded on any engine but "halo".
+std::unique_ptr<Engine> make_engine(const std::string& name, ThreadPool* pool = nullptr, Rule rule = {},
+                                    Topology topology = Topology::Bounded);
+const std::vector<std::string>& engine_names();
+
+} // namespace gol
@@ -1,4 +1,7 @@
 #include "golife.h"
+#include "kernels.h"
+#include "metrics.h"
+#include "thread_pool.h"
 #include <iostream>
 #include <cassert>
 #include <algorithm>
@@ -44,24 +47,47 @@ void Board::flip_state(int x,int y) noexcept
     }
 }
 
-Board Board::tick() const noexcept
+Board Board::tick(Rule rule) const noexcept
 {
-    Board nb = *this;
-    for (int y = 0; y < nrows; ++y) {
-        for (int x = 0; x < ncols; ++x) {
-            const int ns = live_neighbors(x, y);
-            if (ns == 3) {
-                nb.set_live(x, y);
-            } else if (live(x, y) && ns == 2) {
-                nb.set_live(x, y);
-            } else {
-                nb.set_dead(x, y);
-            }
-        }
-    }
+    Board nb;
+    tick_into(nb, rule);
+    return nb;
+}
+
+Board Board::tick(ThreadPool& pool, Rule rule) const noexcept
+{
+    Board nb;
+    tick_into(nb, pool, rule);
     return nb;
 }
 
+// Every cell of `next` is overwritten, so it only needs to be reallocated
+// when the dimensions differ; stepping back and forth between two boards
+// does no allocation after the first generation.
+void Board::tick_into(Board& next, Rule rule) const noexcept
+{
+    assert(&next != this);
+    if (next.nrows != nrows || next.ncols != ncols) {
+        next = Board(nrows, ncols);
+    }
+    tick_rows(*this, next, 0, nrows, rule);
+    count_generation();
+    count_cells(static_cast<std::uint64_t>(brd.size()));
+}
+
+void Board::tick_into(Board& next, ThreadPool& pool, Rule rule) const noexcept
+{
+    assert(&next != this);
+    if (next.nrows != nrows || next.ncols != ncols) {
+        next = Board(nrows, ncols);
+    }
+    parallel_rows(pool, nrows, [&](int y0, int y1) {
+        tick_rows(*this, next, y0, y1, rule);
+        count_cells(static_cast<std::uint64_t>(y1 - y0)*static_cast<std::uint64_t>(ncols));
+    });
+    count_generation();
+}
+
 int Board::live_neighbors(const int x, const int y) const noexcept
 {
     int result = 0;
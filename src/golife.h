@@ -1,10 +1,13 @@
 #pragma once
 
+#include "rule.h"
 #include <vector>
 #include <iosfwd>
 
 namespace gol {
 
+class ThreadPool;
+
 struct Board
 {
     Board() noexcept = default;
@@ -15,7 +18,10 @@ struct Board
     void set_live(int x, int y) noexcept;
     void set_dead(int x, int y) noexcept;
     void flip_state(int x,int y) noexcept;
-    Board tick() const noexcept;
+    Board tick(Rule rule = {}) const noexcept;
+    Board tick(ThreadPool& pool, Rule rule = {}) const noexcept;
+    void tick_into(Board& next, Rule rule = {}) const noexcept;
+    void tick_into(Board& next, ThreadPool& pool, Rule rule = {}) const noexcept;
     int live_neighbors(int x, int y) const noexcept;
     bool empty() const noexcept;
 
@@ -0,0 +1,202 @@
+#include "grid_view.h"
+#include "golife.h"
+
+#include <GL/gl3w.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace {
+
+constexpr float MinZoom = 1.0f / 256;
+constexpr float MaxZoom = 64;
+constexpr float GridZoom = 8;   // draw cell borders from this zoom on
+constexpr int   MaxSamples = 2; // per axis, for a pixel covering many cells
+
+int ClampToInt(double v, int lo, int hi) noexcept
+{
+    return static_cast<int>(std::clamp(v, static_cast<double>(lo), static_cast<double>(hi)));
+}
+
+} // namespace
+
+bool VisibleRegion(const gol::Board& b, ImVec2 size, float zoom, double center_x, double center_y,
+        GridRegion& out) noexcept
+{
+    const double left = center_x - size.x / (2.0 * zoom);
+    const double top = center_y - size.y / (2.0 * zoom);
+    out.x0 = ClampToInt(std::floor(left), 0, b.ncols);
+    out.y0 = ClampToInt(std::floor(top), 0, b.nrows);
+    out.x1 = ClampToInt(std::ceil(left + size.x / zoom), 0, b.ncols);
+    out.y1 = ClampToInt(std::ceil(top + size.y / zoom), 0, b.nrows);
+    if (out.x0 >= out.x1 || out.y0 >= out.y1) {
+        return false;
+    }
+    out.w = out.x1 - out.x0;
+    out.h = out.y1 - out.y0;
+    if (zoom < 1) {
+        out.w = std::max(1, static_cast<int>(std::ceil(out.w * zoom)));
+        out.h = std::max(1, static_cast<int>(std::ceil(out.h * zoom)));
+    }
+    return true;
+}
+
+void RenderRegion(const gol::Board& b, const GridRegion& r, std::uint32_t live, std::uint32_t dead,
+        std::vector<std::uint32_t>& pixels)
+{
+    pixels.resize(static_cast<std::size_t>(r.w) * static_cast<std::size_t>(r.h));
+    const int* cells = b.brd.data();
+    const std::size_t stride = static_cast<std::size_t>(b.ncols);
+    std::uint32_t* out = pixels.data();
+
+    if (r.w == r.x1 - r.x0 && r.h == r.y1 - r.y0) {
+        for (int y = r.y0; y < r.y1; ++y) {
+            const int* row = cells + static_cast<std::size_t>(y)*stride;
+            for (int x = r.x0; x < r.x1; ++x) {
+                *out++ = row[x] == gol::Board::LIVE ? live : dead;
+            }
+        }
+        return;
+    }
+
+    // Zoomed out: pixel (px, py) covers cells [xs[px], xs[px+1]) x [ys[py], ys[py+1]).
+    auto edges = [](int c0, int c1, int n) {
+        std::vector<int> e(static_cast<std::size_t>(n) + 1);
+        for (int i = 0; i <= n; ++i) {
+            e[static_cast<std::size_t>(i)] = c0 + static_cast<int>(static_cast<std::int64_t>(c1 - c0) * i / n);
+        }
+        return e;
+    };
+    const std::vector<int> xs = edges(r.x0, r.x1, r.w);
+    const std::vector<int> ys = edges(r.y0, r.y1, r.h);
+    for (int py = 0; py < r.h; ++py) {
+        const int cy0 = ys[static_cast<std::size_t>(py)];
+        const int cy1 = ys[static_cast<std::size_t>(py) + 1];
+        const int step_y = std::max(1, (cy1 - cy0) / MaxSamples);
+        for (int px = 0; px < r.w; ++px) {
+            const int cx0 = xs[static_cast<std::size_t>(px)];
+            const int cx1 = xs[static_cast<std::size_t>(px) + 1];
+            const int step_x = std::max(1, (cx1 - cx0) / MaxSamples);
+            bool any = false;
+            for (int y = cy0; y < cy1 && !any; y += step_y) {
+                const int* row = cells + static_cast<std::size_t>(y)*stride;
+                for (int x = cx0; x < cx1; x += step_x) {
+                    if (row[x] == gol::Board::LIVE) {
+                        any = true;
+                        break;
+                    }
+                }
+            }
+            *out++ = any ? live : dead;
+        }
+    }
+}
+
+GridView::~GridView()
+{
+    Release();
+}
+
+void GridView::Release()
+{
+    if (texture != 0) {
+        GLuint id = texture;
+        glDeleteTextures(1, &id);
+        texture = 0;
+        tex_w = 0;
+        tex_h = 0;
+    }
+}
+
+// The texture only ever grows, so panning and zooming reuse it and only
+// the visible w x h corner is rewritten.
+void GridView::Upload(int w, int h)
+{
+    GLint last_texture = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &last_texture);
+    if (texture == 0) {
+        GLuint id = 0;
+        glGenTextures(1, &id);
+        texture = id;
+    }
+    glBindTexture(GL_TEXTURE_2D, texture);
+    if (w > tex_w || h > tex_h) {
+        tex_w = std::max(w, tex_w);
+        tex_h = std::max(h, tex_h);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tex_w, tex_h, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(last_texture));
+}
+
+bool GridView::Draw(const gol::Board& b, ImVec2 size, int* cell_x, int* cell_y)
+{
+    size.x = std::max(size.x, 1.0f);
+    size.y = std::max(size.y, 1.0f);
+    const ImVec2 origin = ImGui::GetCursorScreenPos();
+    const ImVec2 corner(origin.x + size.x, origin.y + size.y);
+    const ImVec2 mid(origin.x + size.x / 2, origin.y + size.y / 2);
+    ImGui::InvisibleButton("grid", size);
+    const bool hovered = ImGui::IsItemHovered();
+    const bool clicked = ImGui::IsItemClicked(0);
+    const ImGuiIO& io = ImGui::GetIO();
+
+    if (zoom <= 0) {
+        const float fit = std::min(size.x / static_cast<float>(std::max(1, b.ncols)),
+                                   size.y / static_cast<float>(std::max(1, b.nrows)));
+        zoom = std::clamp(fit, MinZoom, MaxZoom);
+        center_x = b.ncols / 2.0;
+        center_y = b.nrows / 2.0;
+    }
+    if (hovered && io.MouseWheel != 0) {
+        // keep the cell under the cursor where it is
+        const double mx = center_x + (io.MousePos.x - mid.x) / zoom;
+        const double my = center_y + (io.MousePos.y - mid.y) / zoom;
+        zoom = std::clamp(zoom * std::pow(1.25f, io.MouseWheel), MinZoom, MaxZoom);
+        center_x = mx - (io.MousePos.x - mid.x) / zoom;
+        center_y = my - (io.MousePos.y - mid.y) / zoom;
+    }
+    if (hovered && (ImGui::IsMouseDown(1) || ImGui::IsMouseDown(2))) {
+        center_x -= io.MouseDelta.x / zoom;
+        center_y -= io.MouseDelta.y / zoom;
+    }
+
+    ImDrawList* dl = ImGui::GetWindowDrawList();
+    dl->PushClipRect(origin, corner, true);
+    GridRegion r;
+    if (VisibleRegion(b, size, zoom, center_x, center_y, r)) {
+        RenderRegion(b, r, live_color, dead_color, pixels);
+        Upload(r.w, r.h);
+        auto screen_x = [&](int x) { return mid.x + static_cast<float>((x - center_x) * zoom); };
+        auto screen_y = [&](int y) { return mid.y + static_cast<float>((y - center_y) * zoom); };
+        const ImVec2 p0(screen_x(r.x0), screen_y(r.y0));
+        const ImVec2 p1(screen_x(r.x1), screen_y(r.y1));
+        const ImVec2 uv1(static_cast<float>(r.w) / tex_w, static_cast<float>(r.h) / tex_h);
+        dl->AddImage(reinterpret_cast<ImTextureID>(static_cast<std::intptr_t>(texture)), p0, p1, ImVec2(0, 0), uv1);
+        if (zoom >= GridZoom) {
+            for (int x = r.x0; x <= r.x1; ++x) {
+                dl->AddLine(ImVec2(screen_x(x), p0.y), ImVec2(screen_x(x), p1.y), grid_color);
+            }
+            for (int y = r.y0; y <= r.y1; ++y) {
+                dl->AddLine(ImVec2(p0.x, screen_y(y)), ImVec2(p1.x, screen_y(y)), grid_color);
+            }
+        }
+    }
+    dl->PopClipRect();
+
+    if (clicked) {
+        const double x = std::floor(center_x + (io.MousePos.x - mid.x) / zoom);
+        const double y = std::floor(center_y + (io.MousePos.y - mid.y) / zoom);
+        if (0 <= x && x < b.ncols && 0 <= y && y < b.nrows) {
+            *cell_x = static_cast<int>(x);
+            *cell_y = static_cast<int>(y);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "imgui.h"
+
+namespace gol {
+struct Board;
+}
+
+// Draws a Board as a single texture.  Each frame only the cells inside the
+// viewport are turned into pixels: one texel per cell when zoomed in, one
+// texel per screen pixel when zoomed out, so the upload never exceeds the
+// size of the view however large the board is.
+//
+// The mouse wheel zooms around the cursor and dragging with the right or
+// middle button pans.
+struct GridView
+{
+    GridView() = default;
+    ~GridView();
+    GridView(const GridView&) = delete;
+    GridView& operator=(const GridView&) = delete;
+
+    // Fill a `size` region at the cursor with the board.  Returns true when
+    // a cell was left-clicked, and stores it in (*cell_x, *cell_y).
+    bool Draw(const gol::Board& b, ImVec2 size, int* cell_x, int* cell_y);
+    // Fit the whole board into the view on the next Draw().
+    void Fit() noexcept { zoom = 0; }
+    // Free the texture; needs the GL context, so call it before tearing
+    // that down.
+    void Release();
+
+    float  zoom = 0;      // screen pixels per cell, 0 until the first Draw()
+    double center_x = 0;  // board coordinates at the centre of the view
+    double center_y = 0;
+
+    std::uint32_t live_color = 0xffffffff; // packed as by ImGui::GetColorU32()
+    std::uint32_t dead_color = 0xff000000;
+    std::uint32_t grid_color = 0x40000000;
+
+private:
+    void Upload(int w, int h);
+
+    unsigned texture = 0;
+    int tex_w = 0;
+    int tex_h = 0;
+    std::vector<std::uint32_t> pixels;
+};
+
+// The part of the board shown in a view: cells [x0, x1) x [y0, y1) drawn
+// as a w x h pixel image.
+struct GridRegion
+{
+    int x0, y0, x1, y1;
+    int w, h;
+};
+
+// Visible cells for a view of `size` pixels, or false if none are.
+bool VisibleRegion(const gol::Board& b, ImVec2 size, float zoom, double center_x, double center_y,
+        GridRegion& out) noexcept;
+// Convert the region into `pixels` (row-major, region.w x region.h).  When
+// several cells share a pixel it is live if any of a few sampled cells is.
+void RenderRegion(const gol::Board& b, const GridRegion& region, std::uint32_t live, std::uint32_t dead,
+        std::vector<std::uint32_t>& pixels);
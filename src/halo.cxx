@@ -0,0 +1,273 @@
+#include "halo.h"
+#include "golife.h"
+#include "metrics.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <utility>
+
+namespace gol {
+
+namespace {
+
+// Sixteen cells at a time; SSE2 is the x86-64 baseline, so this needs no
+// dispatch.  Loads go through memcpy because rows are not aligned.
+using Bytes = std::uint8_t __attribute__((vector_size(16)));
+constexpr int BYTES = static_cast<int>(sizeof(Bytes));
+
+inline Bytes load(const std::uint8_t* p) noexcept
+{
+    Bytes v;
+    std::memcpy(&v, p, sizeof v);
+    return v;
+}
+
+inline Bytes splat(std::uint8_t b) noexcept
+{
+    Bytes v;
+    std::memset(&v, b, sizeof v);
+    return v;
+}
+
+inline void store(std::uint8_t* p, Bytes v) noexcept
+{
+    std::memcpy(p, &v, sizeof v);
+}
+
+// `up`, `cur` and `down` point at x = 0 of three padded rows, so x - 1 and
+// x + 1 are always readable: at the edges they are halo cells.
+inline Bytes neighbours(const std::uint8_t* up, const std::uint8_t* cur, const std::uint8_t* down, int x) noexcept
+{
+    return load(up + x - 1) + load(up + x) + load(up + x + 1)
+         + load(cur + x - 1)                + load(cur + x + 1)
+         + load(down + x - 1) + load(down + x) + load(down + x + 1);
+}
+
+inline unsigned neighbours1(const std::uint8_t* up, const std::uint8_t* cur, const std::uint8_t* down, int x) noexcept
+{
+    return up[x - 1] + up[x] + up[x + 1]
+         + cur[x - 1]        + cur[x + 1]
+         + down[x - 1] + down[x] + down[x + 1];
+}
+
+// All ones in the lanes whose count has its bit set in Mask, as a chain
+// of compares against constants.
+template <std::uint16_t Mask, int... N>
+inline Bytes in_mask(Bytes n, std::integer_sequence<int, N...>) noexcept
+{
+    Bytes m = {};
+    ((m |= ((Mask >> N) & 1u) ? __builtin_convertvector(n == splat(N), Bytes) : Bytes{}), ...);
+    return m;
+}
+
+template <class R>
+void tick_row(const std::uint8_t* up, const std::uint8_t* cur, const std::uint8_t* down,
+              std::uint8_t* out, int ncols) noexcept
+{
+    using Counts = std::make_integer_sequence<int, 9>;
+    int x = 0;
+    for (; x + BYTES <= ncols; x += BYTES) {
+        const Bytes n = neighbours(up, cur, down, x);
+        const Bytes c = load(cur + x);
+        store(out + x, ((in_mask<R::birth>(n, Counts{}) & ~c) | (in_mask<R::survive>(n, Counts{}) & c)) & splat(1));
+    }
+    for (; x < ncols; ++x) {
+        const unsigned n = neighbours1(up, cur, down, x);
+        const unsigned mask = cur[x] ? R::survive : R::birth;
+        out[x] = static_cast<std::uint8_t>((mask >> n) & 1u);
+    }
+}
+
+// Any other rule: the same compares, against masks that are only known
+// at run time.
+void tick_row(const std::uint8_t* up, const std::uint8_t* cur, const std::uint8_t* down,
+              std::uint8_t* out, int ncols, Rule rule) noexcept
+{
+    Bytes born[9];
+    Bytes stay[9];
+    for (int k = 0; k < 9; ++k) {
+        born[k] = splat(static_cast<std::uint8_t>((rule.birth >> k) & 1u));
+        stay[k] = splat(static_cast<std::uint8_t>((rule.survive >> k) & 1u));
+    }
+    int x = 0;
+    for (; x + BYTES <= ncols; x += BYTES) {
+        const Bytes n = neighbours(up, cur, down, x);
+        const Bytes c = load(cur + x);
+        Bytes next = {};
+        for (int k = 0; k < 9; ++k) {
+            const Bytes hit = __builtin_convertvector(n == splat(static_cast<std::uint8_t>(k)), Bytes);
+            next |= hit & ((born[k] & ~c) | (stay[k] & c));
+        }
+        store(out + x, next);
+    }
+    for (; x < ncols; ++x) {
+        const unsigned n = neighbours1(up, cur, down, x);
+        const unsigned mask = cur[x] ? rule.survive : rule.birth;
+        out[x] = static_cast<std::uint8_t>((mask >> n) & 1u);
+    }
+}
+
+} // namespace
+
+const char* topology_name(Topology t) noexcept
+{
+    switch (t) {
+        case Topology::Bounded:     return "bounded";
+        case Topology::Torus:       return "torus";
+        case Topology::KleinBottle: return "klein";
+    }
+    return "unknown";
+}
+
+bool parse_topology(const char* name, Topology* t) noexcept
+{
+    for (Topology cand : { Topology::Bounded, Topology::Torus, Topology::KleinBottle }) {
+        if (std::strcmp(name, topology_name(cand)) == 0) {
+            *t = cand;
+            return true;
+        }
+    }
+    return false;
+}
+
+HaloBoard::HaloBoard(int nrows, int ncols, Topology topology)
+    : rows{nrows}
+    , cols{ncols}
+    , stride{ncols + 2}
+    , topo{topology}
+    , cells(static_cast<std::size_t>(nrows + 2)*static_cast<std::size_t>(ncols + 2), 0)
+{
+}
+
+HaloBoard::HaloBoard(const Board& b, Topology topology)
+    : HaloBoard(b.nrows, b.ncols, topology)
+{
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < cols; ++x) {
+            cells[ix(x, y)] = static_cast<std::uint8_t>(b.live(x, y));
+        }
+    }
+    fill_halo();
+}
+
+void HaloBoard::set_live(int x, int y) noexcept
+{
+    set(x, y, 1);
+}
+
+void HaloBoard::set_dead(int x, int y) noexcept
+{
+    set(x, y, 0);
+}
+
+void HaloBoard::set(int x, int y, std::uint8_t state) noexcept
+{
+    assert(0 <= x && x < cols);
+    assert(0 <= y && y < rows);
+    cells[ix(x, y)] = state;
+    if (x == 0 || y == 0 || x == cols - 1 || y == rows - 1) {
+        fill_halo();
+    }
+}
+
+void HaloBoard::tick_into(HaloBoard& next, Rule rule) const noexcept
+{
+    assert(&next != this);
+    if (next.rows != rows || next.cols != cols || next.topo != topo) {
+        next = HaloBoard(rows, cols, topo);
+    }
+    tick_rows(next, 0, rows, rule);
+    next.fill_halo();
+    count_generation();
+    count_cells(static_cast<std::uint64_t>(rows)*static_cast<std::uint64_t>(cols));
+}
+
+void HaloBoard::tick_into(HaloBoard& next, ThreadPool& pool, Rule rule) const noexcept
+{
+    assert(&next != this);
+    if (next.rows != rows || next.cols != cols || next.topo != topo) {
+        next = HaloBoard(rows, cols, topo);
+    }
+    parallel_rows(pool, rows, [&](int y0, int y1) {
+        tick_rows(next, y0, y1, rule);
+        count_cells(static_cast<std::uint64_t>(y1 - y0)*static_cast<std::uint64_t>(cols));
+    });
+    next.fill_halo();
+    count_generation();
+}
+
+// Only interior cells are written; the halo of `next` is filled afterwards.
+void HaloBoard::tick_rows(HaloBoard& next, int y0, int y1, Rule rule) const noexcept
+{
+    const std::size_t s = static_cast<std::size_t>(stride);
+    const bool fixed = with_fixed_rule(rule, [&](auto r) {
+        for (int y = y0; y < y1; ++y) {
+            const std::uint8_t* cur = cells.data() + ix(0, y);
+            tick_row<decltype(r)>(cur - s, cur, cur + s, next.cells.data() + ix(0, y), cols);
+        }
+    });
+    if (!fixed) {
+        for (int y = y0; y < y1; ++y) {
+            const std::uint8_t* cur = cells.data() + ix(0, y);
+            tick_row(cur - s, cur, cur + s, next.cells.data() + ix(0, y), cols, rule);
+        }
+    }
+}
+
+// Columns first, for the interior rows; then whole rows including the
+// halo columns, which takes the corners along.  A bounded board's halo is
+// never written, so it stays dead.
+void HaloBoard::fill_halo() noexcept
+{
+    if (topo == Topology::Bounded || rows == 0 || cols == 0) {
+        return;
+    }
+    const std::size_t s = static_cast<std::size_t>(stride);
+    std::uint8_t* const p = cells.data();
+    for (int y = 0; y < rows; ++y) {
+        std::uint8_t* r = p + ix(0, y);
+        r[-1] = r[cols - 1];
+        r[cols] = r[0];
+    }
+    const std::uint8_t* first = p + s;
+    const std::uint8_t* last = p + static_cast<std::size_t>(rows)*s;
+    std::uint8_t* top = p;
+    std::uint8_t* bottom = p + static_cast<std::size_t>(rows + 1)*s;
+    if (topo == Topology::Torus) {
+        std::copy(last, last + s, top);
+        std::copy(first, first + s, bottom);
+    } else {
+        // crossing the top or bottom edge mirrors left and right
+        std::reverse_copy(last, last + s, top);
+        std::reverse_copy(first, first + s, bottom);
+    }
+}
+
+std::int64_t HaloBoard::population() const noexcept
+{
+    std::int64_t result = 0;
+    for (int y = 0; y < rows; ++y) {
+        const std::uint8_t* r = row(y);
+        for (int x = 0; x < cols; ++x) {
+            result += r[x];
+        }
+    }
+    return result;
+}
+
+Board HaloBoard::to_board() const
+{
+    Board b(rows, cols);
+    for (int y = 0; y < rows; ++y) {
+        const std::uint8_t* r = row(y);
+        for (int x = 0; x < cols; ++x) {
+            if (r[x]) {
+                b.set_live(x, y);
+            }
+        }
+    }
+    return b;
+}
+
+} // namespace gol
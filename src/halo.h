@@ -0,0 +1,70 @@
+#pragma once
+
+#include "rule.h"
+#include <cstdint>
+#include <vector>
+
+namespace gol {
+
+struct Board;
+class ThreadPool;
+
+// What lies past the edges of a board.  Bounded: dead cells.  Torus: the
+// opposite edge.  KleinBottle: the opposite edge left to right, and the
+// opposite edge mirrored left-right from top to bottom.
+enum class Topology
+{
+    Bounded,
+    Torus,
+    KleinBottle,
+};
+
+const char* topology_name(Topology t) noexcept;
+bool parse_topology(const char* name, Topology* t) noexcept;
+
+// One byte per cell with a one-cell halo around the board.  The halo holds
+// copies of whatever the topology puts past each edge and is refreshed
+// once per generation, which costs O(rows + cols), so the interior kernel
+// reads all eight neighbours of every cell without a bounds check or a
+// branch, and wrapped boards step as fast as bounded ones.
+class HaloBoard
+{
+public:
+    HaloBoard() = default;
+    HaloBoard(int nrows, int ncols, Topology topology = Topology::Bounded);
+    explicit HaloBoard(const Board& b, Topology topology = Topology::Bounded);
+
+    int nrows() const noexcept { return rows; }
+    int ncols() const noexcept { return cols; }
+    Topology topology() const noexcept { return topo; }
+    bool live(int x, int y) const noexcept { return cells[ix(x, y)] != 0; }
+    bool dead(int x, int y) const noexcept { return !live(x, y); }
+    void set_live(int x, int y) noexcept;
+    void set_dead(int x, int y) noexcept;
+
+    // `next` takes this board's size and topology.
+    void tick_into(HaloBoard& next, Rule rule = {}) const noexcept;
+    void tick_into(HaloBoard& next, ThreadPool& pool, Rule rule = {}) const noexcept;
+    std::int64_t population() const noexcept;
+    Board to_board() const;
+
+    // Row y of the interior, ncols() cells starting at x = 0.
+    const std::uint8_t* row(int y) const noexcept { return cells.data() + ix(0, y); }
+
+private:
+    std::size_t ix(int x, int y) const noexcept
+    {
+        return static_cast<std::size_t>(y + 1)*static_cast<std::size_t>(stride) + static_cast<std::size_t>(x + 1);
+    }
+    void set(int x, int y, std::uint8_t state) noexcept;
+    void tick_rows(HaloBoard& next, int y0, int y1, Rule rule) const noexcept;
+    void fill_halo() noexcept;
+
+    int rows = 0;
+    int cols = 0;
+    int stride = 2; // cols + 2
+    Topology topo = Topology::Bounded;
+    std::vector<std::uint8_t> cells = {};
+};
+
+} // namespace gol
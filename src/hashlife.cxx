@@ -0,0 +1,483 @@
+#include "hashlife.h"
+#include "golife.h"
+#include "pattern.h"
+#include <algorithm>
+#include <cassert>
+
+namespace gol {
+
+namespace {
+
+constexpr std::int64_t side(int level) noexcept
+{
+    return std::int64_t{1} << level;
+}
+
+} // namespace
+
+std::size_t HashLife::KeyHash::operator()(const Key& k) const noexcept
+{
+    const std::uint64_t a = (std::uint64_t{k.nw} << 32) | k.ne;
+    const std::uint64_t b = (std::uint64_t{k.sw} << 32) | k.se;
+    std::uint64_t h = a * 0x9e3779b97f4a7c15ull ^ (b + 0x632be59bd9b4e019ull) * 0xc2b2ae3d27d4eb4full;
+    h ^= h >> 29;
+    return static_cast<std::size_t>(h);
+}
+
+HashLife::HashLife(std::size_t memory_limit)
+    : limit{memory_limit}
+{
+    clear();
+}
+
+HashLife::HashLife(const Board& b, std::size_t memory_limit)
+    : limit{memory_limit}
+{
+    load(b);
+}
+
+void HashLife::reset_tables()
+{
+    nodes.clear();
+    table.clear();
+    results.clear();
+    empties.clear();
+    nodes.push_back(Node{DEAD, DEAD, DEAD, DEAD, 0, 0});
+    nodes.push_back(Node{DEAD, DEAD, DEAD, DEAD, 0, 1});
+    empties.push_back(DEAD);
+}
+
+void HashLife::clear()
+{
+    reset_tables();
+    root = empty(3);
+    origin_x = 0;
+    origin_y = 0;
+    gen = 0;
+}
+
+// The Board's top-left corner becomes (0, 0) in universe coordinates.
+void HashLife::load(const Board& b)
+{
+    reset_tables();
+    int level = 3;
+    while (side(level) < std::max(b.nrows, b.ncols)) {
+        ++level;
+    }
+    root = build(b, level, 0, 0);
+    origin_x = 0;
+    origin_y = 0;
+    gen = 0;
+}
+
+HashLife::NodeId HashLife::build(const Board& b, int level, std::int64_t x0, std::int64_t y0)
+{
+    if (x0 >= b.ncols || y0 >= b.nrows) {
+        return empty(level);
+    }
+    if (level == 0) {
+        return b.live(static_cast<int>(x0), static_cast<int>(y0)) ? LIVE : DEAD;
+    }
+    const std::int64_t half = side(level - 1);
+    const NodeId nw = build(b, level - 1, x0, y0);
+    const NodeId ne = build(b, level - 1, x0 + half, y0);
+    const NodeId sw = build(b, level - 1, x0, y0 + half);
+    const NodeId se = build(b, level - 1, x0 + half, y0 + half);
+    return join(nw, ne, sw, se);
+}
+
+// Cells outside the window are dropped.
+Board HashLife::to_board(int nrows, int ncols) const
+{
+    Board b(nrows, ncols);
+    write_cells(b, root, origin_x, origin_y);
+    return b;
+}
+
+void HashLife::write_cells(Board& b, NodeId n, std::int64_t x0, std::int64_t y0) const
+{
+    const Node& nd = node(n);
+    if (nd.pop == 0) {
+        return;
+    }
+    const std::int64_t size = side(nd.level);
+    if (x0 >= b.ncols || y0 >= b.nrows || x0 + size <= 0 || y0 + size <= 0) {
+        return;
+    }
+    if (nd.level == 0) {
+        b.set_live(static_cast<int>(x0), static_cast<int>(y0));
+        return;
+    }
+    const std::int64_t half = size / 2;
+    write_cells(b, nd.nw, x0, y0);
+    write_cells(b, nd.ne, x0 + half, y0);
+    write_cells(b, nd.sw, x0, y0 + half);
+    write_cells(b, nd.se, x0 + half, y0 + half);
+}
+
+void HashLife::load(const Macrocell& mc)
+{
+    reset_tables();
+    std::vector<NodeId> ids(mc.nodes.size(), DEAD);
+    for (std::size_t i = 1; i < mc.nodes.size(); ++i) {
+        const Macrocell::Node& nd = mc.nodes[i];
+        if (nd.level == 3) {
+            ids[i] = build_leaf(nd.leaf, 3, 0, 0);
+            continue;
+        }
+        auto child = [&](std::uint32_t c) { return c == 0 ? empty(nd.level - 1) : ids[c]; };
+        ids[i] = join(child(nd.nw), child(nd.ne), child(nd.sw), child(nd.se));
+    }
+    root = mc.root == 0 ? empty(3) : ids[mc.root];
+    origin_x = 0;
+    origin_y = 0;
+    gen = 0;
+}
+
+HashLife::NodeId HashLife::build_leaf(std::uint64_t bits, int level, int x0, int y0)
+{
+    if (level == 0) {
+        return (bits >> (8*y0 + x0)) & 1 ? LIVE : DEAD;
+    }
+    const int half = 1 << (level - 1);
+    const NodeId nw = build_leaf(bits, level - 1, x0, y0);
+    const NodeId ne = build_leaf(bits, level - 1, x0 + half, y0);
+    const NodeId sw = build_leaf(bits, level - 1, x0, y0 + half);
+    const NodeId se = build_leaf(bits, level - 1, x0 + half, y0 + half);
+    return join(nw, ne, sw, se);
+}
+
+// Children are written before their parents, so the root comes last.
+Macrocell HashLife::to_macrocell() const
+{
+    Macrocell mc;
+    mc.nodes.push_back(Macrocell::Node{0, 0, 0, 0, 0, 0});
+    std::unordered_map<NodeId, std::uint32_t> seen;
+    mc.root = export_node(mc, root, seen);
+    return mc;
+}
+
+std::uint32_t HashLife::export_node(Macrocell& mc, NodeId n, std::unordered_map<NodeId, std::uint32_t>& seen) const
+{
+    const Node& nd = node(n);
+    if (nd.pop == 0) {
+        return 0;
+    }
+    auto it = seen.find(n);
+    if (it != seen.end()) {
+        return it->second;
+    }
+    Macrocell::Node out{nd.level, 0, 0, 0, 0, 0};
+    if (nd.level == 3) {
+        for (int y = 0; y < 8; ++y) {
+            for (int x = 0; x < 8; ++x) {
+                if (cell(n, x, y)) {
+                    out.leaf |= std::uint64_t{1} << (8*y + x);
+                }
+            }
+        }
+    } else {
+        out.nw = export_node(mc, nd.nw, seen);
+        out.ne = export_node(mc, nd.ne, seen);
+        out.sw = export_node(mc, nd.sw, seen);
+        out.se = export_node(mc, nd.se, seen);
+    }
+    mc.nodes.push_back(out);
+    const auto id = static_cast<std::uint32_t>(mc.nodes.size() - 1);
+    seen.emplace(n, id);
+    return id;
+}
+
+bool HashLife::live(std::int64_t x, std::int64_t y) const noexcept
+{
+    const std::int64_t size = side(node(root).level);
+    x -= origin_x;
+    y -= origin_y;
+    if (x < 0 || y < 0 || x >= size || y >= size) {
+        return false;
+    }
+    return cell(root, x, y);
+}
+
+bool HashLife::cell(NodeId n, std::int64_t x, std::int64_t y) const noexcept
+{
+    for (;;) {
+        const Node& nd = node(n);
+        if (nd.pop == 0) {
+            return false;
+        }
+        if (nd.level == 0) {
+            return n == LIVE;
+        }
+        const std::int64_t half = side(nd.level - 1);
+        const bool east = x >= half;
+        const bool south = y >= half;
+        n = south ? (east ? nd.se : nd.sw) : (east ? nd.ne : nd.nw);
+        x -= east ? half : 0;
+        y -= south ? half : 0;
+    }
+}
+
+void HashLife::set_live(std::int64_t x, std::int64_t y)
+{
+    for (;;) {
+        const std::int64_t size = side(node(root).level);
+        if (origin_x <= x && x < origin_x + size && origin_y <= y && y < origin_y + size) {
+            break;
+        }
+        grow();
+    }
+    root = set_cell(root, x - origin_x, y - origin_y);
+}
+
+HashLife::NodeId HashLife::set_cell(NodeId n, std::int64_t x, std::int64_t y)
+{
+    const Node nd = node(n);
+    if (nd.level == 0) {
+        return LIVE;
+    }
+    const std::int64_t half = side(nd.level - 1);
+    if (y < half) {
+        if (x < half) {
+            return join(set_cell(nd.nw, x, y), nd.ne, nd.sw, nd.se);
+        }
+        return join(nd.nw, set_cell(nd.ne, x - half, y), nd.sw, nd.se);
+    }
+    if (x < half) {
+        return join(nd.nw, nd.ne, set_cell(nd.sw, x, y - half), nd.se);
+    }
+    return join(nd.nw, nd.ne, nd.sw, set_cell(nd.se, x - half, y - half));
+}
+
+std::uint64_t HashLife::population() const noexcept
+{
+    return node(root).pop;
+}
+
+HashLife::NodeId HashLife::join(NodeId nw, NodeId ne, NodeId sw, NodeId se)
+{
+    const Key key{nw, ne, sw, se};
+    auto it = table.find(key);
+    if (it != table.end()) {
+        return it->second;
+    }
+    const NodeId id = static_cast<NodeId>(nodes.size());
+    const std::uint64_t pop = node(nw).pop + node(ne).pop + node(sw).pop + node(se).pop;
+    nodes.push_back(Node{nw, ne, sw, se, node(nw).level + 1, pop});
+    table.emplace(key, id);
+    return id;
+}
+
+HashLife::NodeId HashLife::empty(int level)
+{
+    while (static_cast<int>(empties.size()) <= level) {
+        const NodeId e = empties.back();
+        empties.push_back(join(e, e, e, e));
+    }
+    return empties[static_cast<std::size_t>(level)];
+}
+
+// The same pattern one level up, centred in an empty border.
+HashLife::NodeId HashLife::expand(NodeId n)
+{
+    const Node nd = node(n);
+    const NodeId e = empty(nd.level - 1);
+    return join(join(e, e, e, nd.nw),
+                join(e, e, nd.ne, e),
+                join(e, nd.sw, e, e),
+                join(nd.se, e, e, e));
+}
+
+void HashLife::grow()
+{
+    const std::int64_t quarter = side(node(root).level - 1);
+    root = expand(root);
+    origin_x -= quarter;
+    origin_y -= quarter;
+}
+
+// Whether every live cell lies in the central quarter (by side length) of
+// the root, leaving room for the pattern to spread during a step.
+bool HashLife::padded() const noexcept
+{
+    const Node& r = node(root);
+    if (r.level < 3) {
+        return false;
+    }
+    return r.pop == node(node(node(r.nw).se).se).pop
+                  + node(node(node(r.ne).sw).sw).pop
+                  + node(node(node(r.sw).ne).ne).pop
+                  + node(node(node(r.se).nw).nw).pop;
+}
+
+// One generation of a 4x4 node, giving its central 2x2.
+HashLife::NodeId HashLife::base_successor(NodeId n)
+{
+    unsigned bits = 0;
+    for (int y = 0; y < 4; ++y) {
+        for (int x = 0; x < 4; ++x) {
+            if (cell(n, x, y)) {
+                bits |= 1u << (y*4 + x);
+            }
+        }
+    }
+    auto next = [bits](int x, int y) {
+        int count = 0;
+        for (int dy = -1; dy <= 1; ++dy) {
+            for (int dx = -1; dx <= 1; ++dx) {
+                if (dx != 0 || dy != 0) {
+                    count += (bits >> ((y + dy)*4 + x + dx)) & 1;
+                }
+            }
+        }
+        const bool alive = (bits >> (y*4 + x)) & 1;
+        return (count == 3 || (alive && count == 2)) ? LIVE : DEAD;
+    };
+    return join(next(1, 1), next(2, 1), next(1, 2), next(2, 2));
+}
+
+// The central half of a level-k node advanced by 2^j generations, for
+// j <= k-2.  When j == k-2 both halves of the recursion advance time;
+// otherwise only the first does and the second just re-centres.
+HashLife::NodeId HashLife::successor(NodeId n, int j)
+{
+    const Node nd = node(n);
+    assert(nd.level >= 2 && j <= nd.level - 2);
+    if (nd.pop == 0) {
+        return empty(nd.level - 1);
+    }
+    const std::uint64_t key = (std::uint64_t{n} << 8) | static_cast<std::uint64_t>(j);
+    auto it = results.find(key);
+    if (it != results.end()) {
+        ++st.hits;
+        return it->second;
+    }
+    ++st.misses;
+
+    NodeId result;
+    if (nd.level == 2) {
+        result = base_successor(n);
+    } else {
+        const Node a = node(nd.nw);
+        const Node b = node(nd.ne);
+        const Node c = node(nd.sw);
+        const Node d = node(nd.se);
+        const NodeId n00 = nd.nw;
+        const NodeId n01 = join(a.ne, b.nw, a.se, b.sw);
+        const NodeId n02 = nd.ne;
+        const NodeId n10 = join(a.sw, a.se, c.nw, c.ne);
+        const NodeId n11 = join(a.se, b.sw, c.ne, d.nw);
+        const NodeId n12 = join(b.sw, b.se, d.nw, d.ne);
+        const NodeId n20 = nd.sw;
+        const NodeId n21 = join(c.ne, d.nw, c.se, d.sw);
+        const NodeId n22 = nd.se;
+        if (j == nd.level - 2) {
+            const NodeId r00 = successor(n00, j - 1);
+            const NodeId r01 = successor(n01, j - 1);
+            const NodeId r02 = successor(n02, j - 1);
+            const NodeId r10 = successor(n10, j - 1);
+            const NodeId r11 = successor(n11, j - 1);
+            const NodeId r12 = successor(n12, j - 1);
+            const NodeId r20 = successor(n20, j - 1);
+            const NodeId r21 = successor(n21, j - 1);
+            const NodeId r22 = successor(n22, j - 1);
+            const NodeId q0 = successor(join(r00, r01, r10, r11), j - 1);
+            const NodeId q1 = successor(join(r01, r02, r11, r12), j - 1);
+            const NodeId q2 = successor(join(r10, r11, r20, r21), j - 1);
+            const NodeId q3 = successor(join(r11, r12, r21, r22), j - 1);
+            result = join(q0, q1, q2, q3);
+        } else {
+            const NodeId r00 = successor(n00, j);
+            const NodeId r01 = successor(n01, j);
+            const NodeId r02 = successor(n02, j);
+            const NodeId r10 = successor(n10, j);
+            const NodeId r11 = successor(n11, j);
+            const NodeId r12 = successor(n12, j);
+            const NodeId r20 = successor(n20, j);
+            const NodeId r21 = successor(n21, j);
+            const NodeId r22 = successor(n22, j);
+            auto centre = [this](NodeId p, NodeId q, NodeId r, NodeId s) {
+                return join(node(p).se, node(q).sw, node(r).ne, node(s).nw);
+            };
+            const NodeId q0 = centre(r00, r01, r10, r11);
+            const NodeId q1 = centre(r01, r02, r11, r12);
+            const NodeId q2 = centre(r10, r11, r20, r21);
+            const NodeId q3 = centre(r11, r12, r21, r22);
+            result = join(q0, q1, q2, q3);
+        }
+    }
+    results.emplace(key, result);
+    return result;
+}
+
+// Advance by each power of two in `generations` in turn.  Before each jump
+// the root is padded so that the pattern, moving at most one cell per
+// generation, cannot leave the central region that successor() returns.
+void HashLife::advance(std::uint64_t generations)
+{
+    for (int j = 0; j < 64 && (generations >> j) != 0; ++j) {
+        if (((generations >> j) & 1) == 0) {
+            continue;
+        }
+        while (node(root).level < j + 3 || !padded()) {
+            grow();
+        }
+        const std::int64_t quarter = side(node(root).level - 2);
+        root = successor(root, j);
+        origin_x += quarter;
+        origin_y += quarter;
+        gen += std::uint64_t{1} << j;
+        if (memory_usage() > limit) {
+            collect();
+        }
+    }
+}
+
+void HashLife::collect()
+{
+    const std::vector<Node> old = std::move(nodes);
+    const NodeId old_root = root;
+    reset_tables();
+    std::unordered_map<NodeId, NodeId> seen;
+    root = rebuild(old, old_root, seen);
+    ++st.collections;
+}
+
+HashLife::NodeId HashLife::rebuild(const std::vector<Node>& old, NodeId n, std::unordered_map<NodeId, NodeId>& seen)
+{
+    if (n == DEAD || n == LIVE) {
+        return n;
+    }
+    auto it = seen.find(n);
+    if (it != seen.end()) {
+        return it->second;
+    }
+    const Node& nd = old[n];
+    const NodeId nw = rebuild(old, nd.nw, seen);
+    const NodeId ne = rebuild(old, nd.ne, seen);
+    const NodeId sw = rebuild(old, nd.sw, seen);
+    const NodeId se = rebuild(old, nd.se, seen);
+    const NodeId id = join(nw, ne, sw, se);
+    seen.emplace(n, id);
+    return id;
+}
+
+// An estimate: the node arena plus the entries and buckets of both tables.
+std::size_t HashLife::memory_usage() const noexcept
+{
+    const std::size_t entry_overhead = 2*sizeof(void*);
+    return nodes.capacity()*sizeof(Node)
+         + table.size()*(sizeof(Key) + sizeof(NodeId) + entry_overhead)
+         + table.bucket_count()*sizeof(void*)
+         + results.size()*(sizeof(std::uint64_t) + sizeof(NodeId) + entry_overhead)
+         + results.bucket_count()*sizeof(void*);
+}
+
+const HashLife::Stats& HashLife::stats() const noexcept
+{
+    st.nodes = nodes.size();
+    st.cached = results.size();
+    return st;
+}
+
+} // namespace gol
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace gol {
+
+struct Board;
+struct Macrocell;
+
+// HashLife: the universe is a quadtree whose nodes are hash-consed, so
+// identical regions share one canonical node, and the result of advancing
+// each node is memoized.  advance() jumps by powers of two, which makes
+// generation counts in the billions reachable for patterns with enough
+// regularity.
+//
+// Unlike Board the universe is unbounded; results match Board::tick() for
+// as long as the pattern stays clear of the Board's edges.
+class HashLife
+{
+public:
+    struct Stats
+    {
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        std::uint64_t collections = 0;
+        std::size_t nodes = 0;
+        std::size_t cached = 0;
+
+        double hit_rate() const noexcept
+        {
+            const std::uint64_t total = hits + misses;
+            return total == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(total);
+        }
+    };
+
+    static constexpr std::size_t DEFAULT_MEMORY_LIMIT = std::size_t{512} << 20;
+
+    explicit HashLife(std::size_t memory_limit = DEFAULT_MEMORY_LIMIT);
+    explicit HashLife(const Board& b, std::size_t memory_limit = DEFAULT_MEMORY_LIMIT);
+
+    void load(const Board& b);
+    Board to_board(int nrows, int ncols) const;
+    // Macrocell files are quadtrees already, so these map node for node
+    // instead of going through cells.  The root's top-left corner is (0, 0).
+    void load(const Macrocell& mc);
+    Macrocell to_macrocell() const;
+    void clear();
+
+    bool live(std::int64_t x, std::int64_t y) const noexcept;
+    void set_live(std::int64_t x, std::int64_t y);
+    std::uint64_t population() const noexcept;
+    std::uint64_t generation() const noexcept { return gen; }
+
+    void advance(std::uint64_t generations);
+
+    // Drop everything not reachable from the current pattern, including
+    // the whole result cache.  advance() does this by itself whenever the
+    // memory in use goes over the limit.
+    void collect();
+    std::size_t memory_usage() const noexcept;
+    std::size_t memory_limit() const noexcept { return limit; }
+    void set_memory_limit(std::size_t bytes) noexcept { limit = bytes; }
+    const Stats& stats() const noexcept;
+
+private:
+    using NodeId = std::uint32_t;
+
+    struct Node
+    {
+        NodeId nw, ne, sw, se;
+        int level;
+        std::uint64_t pop;
+    };
+
+    struct Key
+    {
+        NodeId nw, ne, sw, se;
+        bool operator==(const Key& o) const noexcept
+        {
+            return nw == o.nw && ne == o.ne && sw == o.sw && se == o.se;
+        }
+    };
+
+    struct KeyHash
+    {
+        std::size_t operator()(const Key& k) const noexcept;
+    };
+
+    static constexpr NodeId DEAD = 0;
+    static constexpr NodeId LIVE = 1;
+
+    const Node& node(NodeId id) const noexcept { return nodes[id]; }
+    NodeId join(NodeId nw, NodeId ne, NodeId sw, NodeId se);
+    NodeId empty(int level);
+    NodeId expand(NodeId n);
+    NodeId successor(NodeId n, int j);
+    NodeId base_successor(NodeId n);
+    NodeId build(const Board& b, int level, std::int64_t x0, std::int64_t y0);
+    NodeId build_leaf(std::uint64_t bits, int level, int x0, int y0);
+    std::uint32_t export_node(Macrocell& mc, NodeId n, std::unordered_map<NodeId, std::uint32_t>& seen) const;
+    NodeId set_cell(NodeId n, std::int64_t x, std::int64_t y);
+    NodeId rebuild(const std::vector<Node>& old, NodeId n, std::unordered_map<NodeId, NodeId>& seen);
+    bool cell(NodeId n, std::int64_t x, std::int64_t y) const noexcept;
+    bool padded() const noexcept;
+    void grow();
+    void reset_tables();
+    void write_cells(Board& b, NodeId n, std::int64_t x0, std::int64_t y0) const;
+
+    std::vector<Node> nodes;
+    std::unordered_map<Key, NodeId, KeyHash> table;
+    std::unordered_map<std::uint64_t, NodeId> results;
+    std::vector<NodeId> empties;
+
+    NodeId root = DEAD;
+    std::int64_t origin_x = 0;
+    std::int64_t origin_y = 0;
+    std::uint64_t gen = 0;
+    std::size_t limit;
+    mutable Stats st;
+};
+
+} // namespace gol
@@ -0,0 +1,315 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <cxxopts.hpp>
+
+#include "checkpoint.h"
+#include "engine.h"
+#include "golife.h"
+#include "kernels.h"
+#include "metrics.h"
+#include "pattern.h"
+#include "soup.h"
+#include "thread_pool.h"
+
+namespace {
+
+gol::Board RandomBoard(int nrows, int ncols, double density, unsigned seed)
+{
+    gol::Board b(nrows, ncols);
+    std::mt19937_64 rng(seed);
+    std::bernoulli_distribution alive(density);
+    for (int y = 0; y < nrows; ++y) {
+        for (int x = 0; x < ncols; ++x) {
+            if (alive(rng)) {
+                b.set_live(x, y);
+            }
+        }
+    }
+    return b;
+}
+
+// `rule` takes the pattern's own rule, if it names one.
+gol::Board StartingBoard(const cxxopts::ParseResult& args, gol::Rule* rule)
+{
+    const int nrows = args["rows"].as<int>();
+    const int ncols = args["cols"].as<int>();
+    if (!args.count("pattern")) {
+        return RandomBoard(nrows, ncols, args["density"].as<double>(), args["seed"].as<unsigned>());
+    }
+    gol::Board pattern = gol::load_pattern(args["pattern"].as<std::string>(), rule);
+    if (!args.count("rows") && !args.count("cols")) {
+        return pattern;
+    }
+    gol::Board b(nrows, ncols);
+    gol::place(b, pattern, (ncols - pattern.ncols) / 2, (nrows - pattern.nrows) / 2);
+    return b;
+}
+
+// Step one generation at a time, timing each and asking the engine what
+// it changed.  `gen` is the generation the engine is at.
+void StepWithMetrics(gol::Engine& engine, std::uint64_t gen, std::int64_t generations,
+                     gol::TickMetrics& metrics, std::vector<gol::TickSample>& samples)
+{
+    using Clock = std::chrono::steady_clock;
+    for (std::int64_t i = 0; i < generations; ++i) {
+        const auto begin = Clock::now();
+        engine.step(1);
+        const auto latency = Clock::now() - begin;
+        samples.push_back({++gen, latency, engine.activity()});
+        metrics.record(samples.back());
+    }
+}
+
+int RunSoups(const cxxopts::ParseResult& args, gol::Rule rule, gol::ThreadPool* pool)
+{
+    using Clock = std::chrono::steady_clock;
+
+    gol::SoupConfig config;
+    config.rows = args.count("rows") ? args["rows"].as<int>() : 32;
+    config.cols = args.count("cols") ? args["cols"].as<int>() : 32;
+    config.soup_size = args["soup-size"].as<int>();
+    config.density = args["density"].as<double>();
+    config.seed = args["seed"].as<unsigned>();
+    config.rule = rule;
+    if (args.count("generations")) {
+        config.max_generations = args["generations"].as<std::int64_t>();
+    }
+    const auto count = args["soups"].as<std::uint64_t>();
+
+    const auto begin = Clock::now();
+    const gol::SoupStats stats = gol::search_soups(config, 0, count, pool);
+    const double secs = std::chrono::duration<double>(Clock::now() - begin).count();
+    const int nthreads = pool ? pool->size() : 1;
+    const double soups = static_cast<double>(stats.soups);
+
+    std::printf("search:       soups (%d threads, %s kernel)\n", nthreads, gol::kernel_name(gol::active_kernel()));
+    std::printf("rule:         %s\n", gol::rule_string(rule).c_str());
+    std::printf("board:        %d x %d, %d x %d soups at density %g\n",
+            config.rows, config.cols, config.soup_size, config.soup_size, config.density);
+    std::printf("soups:        %llu\n", static_cast<unsigned long long>(stats.soups));
+    std::printf("run time:     %.6f s\n", secs);
+    std::printf("soups/sec:    %.1f (%.1f per thread)\n", secs > 0 ? soups / secs : 0.0,
+            secs > 0 ? soups / secs / nthreads : 0.0);
+    std::printf("gens/soup:    %.1f\n", soups > 0 ? static_cast<double>(stats.generations) / soups : 0.0);
+    std::printf("died:         %llu\n", static_cast<unsigned long long>(stats.died));
+    std::printf("unsettled:    %llu\n", static_cast<unsigned long long>(stats.unsettled));
+
+    std::vector<std::pair<std::uint64_t, std::string>> census;
+    for (auto&& [name, n] : stats.census) {
+        census.emplace_back(n, name);
+    }
+    std::sort(census.begin(), census.end(), [](const auto& a, const auto& b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    });
+    std::printf("census:\n");
+    for (auto&& [n, name] : census) {
+        std::printf("%12llu  %s\n", static_cast<unsigned long long>(n), name.c_str());
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    using Clock = std::chrono::steady_clock;
+
+    std::string engine_help = "simulation engine:";
+    for (auto&& name : gol::engine_names()) {
+        engine_help += " " + name;
+    }
+
+    cxxopts::Options options("game-of-life-headless",
+            "Run the Game of Life without rendering and report throughput");
+    options.add_options()
+        ("r,rows", "board rows", cxxopts::value<int>()->default_value("1024"))
+        ("c,cols", "board columns", cxxopts::value<int>()->default_value("1024"))
+        ("p,pattern", "start from this pattern file (plaintext, RLE, Life 1.06 or macrocell), centred on the board, under its rule unless --rule is given", cxxopts::value<std::string>())
+        ("d,density", "live density of the random soup used without --pattern", cxxopts::value<double>()->default_value("0.5"))
+        ("s,seed", "random soup seed", cxxopts::value<unsigned>()->default_value("1"))
+        ("g,generations", "generations to run", cxxopts::value<std::int64_t>()->default_value("1000"))
+        ("e,engine", engine_help, cxxopts::value<std::string>()->default_value("bitboard"))
+        ("topology", "what lies past the edges for the halo engine: bounded, torus or klein (a Klein bottle)", cxxopts::value<std::string>()->default_value("bounded"))
+        ("rule", "B/S rule such as B36/S23, or conway, highlife, daynight, seeds, lwod, maze; hashlife and sparse only run B3/S23", cxxopts::value<std::string>()->default_value("B3/S23"))
+        ("t,threads", "worker threads, 0 for one per core", cxxopts::value<int>()->default_value("1"))
+        ("k,kernel", "force the row kernel: scalar, sse2, avx2 or avx512", cxxopts::value<std::string>())
+        ("o,output", "write the final state to this file; .rle, .lif, .mc or plaintext by extension", cxxopts::value<std::string>())
+        ("resume", "continue from this checkpoint instead of --pattern or a random soup, under its rule and topology unless --rule or --topology is given", cxxopts::value<std::string>())
+        ("checkpoint", "write the final state to this checkpoint file, and the intermediate ones with --checkpoint-every; written on a background thread", cxxopts::value<std::string>())
+        ("checkpoint-every", "generations between checkpoints, 0 for only the final one", cxxopts::value<std::int64_t>()->default_value("0"))
+        ("m,metrics", "step one generation at a time and write per-generation tick latency, population, births and deaths to this file; JSON for .json, CSV otherwise", cxxopts::value<std::string>())
+        ("soups", "instead of one board, run this many random soups on small boards (--rows x --cols, 32 x 32 by default, at most 64 columns) until they settle, and census what is left; --generations caps each soup", cxxopts::value<std::uint64_t>())
+        ("soup-size", "side of the random square each soup starts from", cxxopts::value<int>()->default_value("16"))
+        ("h,help", "print usage")
+        ;
+
+    try {
+        auto args = options.parse(argc, argv);
+        if (args.count("help")) {
+            std::cout << options.help() << std::endl;
+            return 0;
+        }
+
+        if (args.count("kernel")) {
+            gol::Kernel k;
+            const auto name = args["kernel"].as<std::string>();
+            if (!gol::parse_kernel(name.c_str(), &k) || !gol::set_kernel(k)) {
+                std::cerr << "kernel not available: " << name << std::endl;
+                return 1;
+            }
+        }
+
+        const int nthreads = args["threads"].as<int>();
+        std::unique_ptr<gol::ThreadPool> pool;
+        if (nthreads != 1) {
+            pool = std::make_unique<gol::ThreadPool>(nthreads);
+        }
+
+        gol::Rule rule;
+        const auto rule_text = args["rule"].as<std::string>();
+        if (!gol::parse_rule(rule_text, &rule)) {
+            std::cerr << "cannot parse rule: " << rule_text << std::endl;
+            return 1;
+        }
+
+        if (args.count("soups")) {
+            return RunSoups(args, rule, pool.get());
+        }
+
+        gol::Topology topology;
+        const auto topology_text = args["topology"].as<std::string>();
+        if (!gol::parse_topology(topology_text.c_str(), &topology)) {
+            std::cerr << "unknown topology: " << topology_text << std::endl;
+            return 1;
+        }
+
+        std::optional<gol::Checkpoint> resume;
+        if (args.count("resume")) {
+            resume.emplace(args["resume"].as<std::string>());
+            if (!args.count("rule")) {
+                rule = resume->rule();
+            }
+            if (!args.count("topology")) {
+                topology = resume->topology();
+            }
+        }
+
+        // before the engine is made, which needs the pattern's rule
+        const gol::Board start = resume ? gol::Board{} : StartingBoard(args, args.count("rule") ? nullptr : &rule);
+
+        const auto engine_name = args["engine"].as<std::string>();
+        auto engine = gol::make_engine(engine_name, pool.get(), rule, topology);
+        if (!engine) {
+            const auto& names = gol::engine_names();
+            if (std::find(names.begin(), names.end(), engine_name) == names.end()) {
+                std::cerr << "unknown engine: " << engine_name << std::endl;
+            } else if (topology != gol::Topology::Bounded) {
+                std::cerr << "only the halo engine runs a " << gol::topology_name(topology) << " topology" << std::endl;
+            } else {
+                std::cerr << engine_name << " only runs B3/S23" << std::endl;
+            }
+            return 1;
+        }
+
+        const std::int64_t generations = args["generations"].as<std::int64_t>();
+        const std::int64_t every = args["checkpoint-every"].as<std::int64_t>();
+        std::unique_ptr<gol::CheckpointWriter> writer;
+        if (args.count("checkpoint")) {
+            writer = std::make_unique<gol::CheckpointWriter>(args["checkpoint"].as<std::string>());
+        }
+
+        const int nrows = resume ? resume->nrows() : start.nrows;
+        const int ncols = resume ? resume->ncols() : start.ncols;
+        const std::uint64_t first_gen = resume ? resume->generation() : 0;
+
+        const auto load_begin = Clock::now();
+        if (resume) {
+            engine->restore(std::move(*resume));
+        } else {
+            engine->load(start);
+        }
+        const auto run_begin = Clock::now();
+        gol::TickMetrics metrics;
+        std::vector<gol::TickSample> samples;
+        if (args.count("metrics")) {
+            samples.reserve(static_cast<std::size_t>(std::max<std::int64_t>(generations, 0)));
+        }
+        // checkpoints are copied out between chunks and written in the background
+        for (std::int64_t done = 0; done < generations; ) {
+            const std::int64_t n = every > 0 && writer ? std::min(every, generations - done) : generations - done;
+            if (args.count("metrics")) {
+                StepWithMetrics(*engine, first_gen + static_cast<std::uint64_t>(done), n, metrics, samples);
+            } else {
+                engine->step(n);
+            }
+            done += n;
+            if (writer && done < generations) {
+                engine->copy_bits(writer->board());
+                writer->submit(first_gen + static_cast<std::uint64_t>(done), rule, topology);
+            }
+        }
+        const auto run_end = Clock::now();
+        if (writer) {
+            engine->copy_bits(writer->board());
+            writer->submit(first_gen + static_cast<std::uint64_t>(std::max<std::int64_t>(generations, 0)), rule, topology);
+            writer->flush();
+        }
+
+        const double load_secs = std::chrono::duration<double>(run_begin - load_begin).count();
+        const double secs = std::chrono::duration<double>(run_end - run_begin).count();
+        const double cells = static_cast<double>(nrows) * static_cast<double>(ncols);
+        const double gens = static_cast<double>(generations);
+
+        std::printf("engine:       %s (%d threads, %s kernel)\n", engine->name(),
+                pool ? pool->size() : 1, gol::kernel_name(gol::active_kernel()));
+        std::printf("rule:         %s\n", gol::rule_string(rule).c_str());
+        std::printf("board:        %d x %d\n", nrows, ncols);
+        if (topology != gol::Topology::Bounded) {
+            std::printf("topology:     %s\n", gol::topology_name(topology));
+        }
+        if (args.count("resume")) {
+            std::printf("resumed at:   generation %llu\n", static_cast<unsigned long long>(first_gen));
+        }
+        std::printf("generations:  %lld\n", static_cast<long long>(generations));
+        std::printf("load time:    %.6f s\n", load_secs);
+        std::printf("run time:     %.6f s\n", secs);
+        std::printf("gens/sec:     %.3f\n", secs > 0 ? gens / secs : 0.0);
+        std::printf("cells/sec:    %.6g\n", secs > 0 ? cells * gens / secs : 0.0);
+        std::printf("population:   %llu\n", static_cast<unsigned long long>(engine->population()));
+
+        if (args.count("metrics")) {
+            const gol::LatencyHistogram& h = metrics.latency();
+            const auto us = [](std::chrono::nanoseconds t) { return static_cast<double>(t.count()) / 1e3; };
+            std::printf("tick latency: mean %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us\n",
+                    us(h.mean()), us(h.quantile(0.5)), us(h.quantile(0.99)), us(h.max()));
+            if (!samples.empty() && samples.back().change.known()) {
+                std::printf("births:       %lld\n", static_cast<long long>(metrics.births()));
+                std::printf("deaths:       %lld\n", static_cast<long long>(metrics.deaths()));
+            }
+            gol::save_metrics(args["metrics"].as<std::string>(), metrics, samples);
+        }
+        if (writer) {
+            std::printf("checkpoints:  %llu written\n", static_cast<unsigned long long>(writer->written()));
+        }
+
+        if (args.count("output")) {
+            gol::save_pattern(args["output"].as<std::string>(), engine->board(), rule);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
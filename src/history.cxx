@@ -0,0 +1,334 @@
+#include "history.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <utility>
+
+namespace gol {
+
+namespace {
+
+void apply(Board& b, const std::uint32_t* first, const std::uint32_t* last) noexcept
+{
+    for (; first != last; ++first) {
+        int& cell = b.brd[*first];
+        cell = cell == Board::LIVE ? Board::DEAD : Board::LIVE;
+    }
+}
+
+template <class T>
+void put(std::ostream& os, T value)
+{
+    os.write(reinterpret_cast<const char*>(&value), sizeof value);
+}
+
+template <class T>
+void put_array(std::ostream& os, const std::vector<T>& values)
+{
+    put<std::uint64_t>(os, values.size());
+    os.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size()*sizeof(T)));
+}
+
+// Bounds-checked reads from a serialized history.
+class Reader
+{
+public:
+    Reader(const char* data, std::size_t size) noexcept : p{data}, end{data + size} {}
+
+    template <class T>
+    T get()
+    {
+        T value;
+        std::memcpy(&value, take(sizeof value), sizeof value);
+        return value;
+    }
+
+    template <class T>
+    void get_array(std::vector<T>& values, std::size_t n)
+    {
+        if (n > static_cast<std::size_t>(end - p) / sizeof(T)) {
+            fail();
+        }
+        values.resize(n);
+        if (n != 0) {
+            std::memcpy(values.data(), take(n*sizeof(T)), n*sizeof(T));
+        }
+    }
+
+    bool done() const noexcept { return p == end; }
+    [[noreturn]] static void fail() { throw std::runtime_error("checkpoint: malformed history"); }
+
+private:
+    const char* take(std::size_t n)
+    {
+        if (n > static_cast<std::size_t>(end - p)) {
+            fail();
+        }
+        const char* q = p;
+        p += n;
+        return q;
+    }
+
+    const char* p;
+    const char* end;
+};
+
+} // namespace
+
+History::History(Board initial, Rule rule, int keyframe_interval, std::size_t memory_budget)
+    : interval{std::max(1, keyframe_interval)}, budget{memory_budget}
+{
+    reset(std::move(initial), rule);
+}
+
+void History::reset(Board initial, Rule rule)
+{
+    segments.clear();
+    flips.clear();
+    gen = 0;
+    life_rule = rule;
+    last = std::move(initial);
+    Segment s;
+    s.keyframe = BitBoard(last);
+    segments.push_back(std::move(s));
+}
+
+void History::push(Board next)
+{
+    assert(next.nrows == last.nrows && next.ncols == last.ncols);
+    scratch = std::move(next);
+    commit();
+}
+
+// Step the latest generation forward; the two full boards are reused, so
+// this allocates only when the history itself grows.
+void History::advance()
+{
+    last.tick_into(scratch, life_rule);
+    commit();
+}
+
+// Record `scratch` as the next generation.
+void History::commit()
+{
+    flips.clear();
+    for (std::size_t i = 0; i < scratch.brd.size(); ++i) {
+        if (scratch.brd[i] != last.brd[i]) {
+            flips.push_back(static_cast<std::uint32_t>(i));
+        }
+    }
+    std::swap(last, scratch);
+    ++gen;
+
+    Segment& cur = segments.back();
+    if (cur.length >= static_cast<std::size_t>(interval)) {
+        Segment s;
+        s.start = gen;
+        s.keyframe = BitBoard(last);
+        segments.push_back(std::move(s));
+    } else {
+        if (cur.has_deltas) {
+            cur.cells.insert(cur.cells.end(), flips.begin(), flips.end());
+            cur.ends.push_back(static_cast<std::uint32_t>(cur.cells.size()));
+        }
+        ++cur.length;
+    }
+    enforce_budget();
+}
+
+void History::pop()
+{
+    if (gen == 0) {
+        return;
+    }
+    flips.clear();
+    Segment& cur = segments.back();
+    if (cur.length == 1 || !cur.has_deltas) {
+        last = at(gen - 1);
+        if (cur.length == 1) {
+            segments.pop_back();
+        } else {
+            --cur.length;
+        }
+        --gen;
+        return;
+    }
+    --cur.length;
+    --gen;
+    const std::size_t end = cur.ends.back();
+    cur.ends.pop_back();
+    const std::size_t begin = cur.ends.empty() ? 0 : cur.ends.back();
+    apply(last, cur.cells.data() + begin, cur.cells.data() + end);
+    cur.cells.resize(begin);
+}
+
+const History::Segment& History::segment_for(std::size_t generation) const noexcept
+{
+    auto it = std::upper_bound(segments.begin(), segments.end(), generation,
+            [](std::size_t g, const Segment& s) { return g < s.start; });
+    assert(it != segments.begin());
+    return *std::prev(it);
+}
+
+// Bounded by the length of one segment: either that many deltas are
+// replayed, or that many generations re-simulated.
+Board History::at(std::size_t generation) const
+{
+    assert(generation <= gen);
+    if (generation == gen) {
+        return last;
+    }
+    const Segment& s = segment_for(generation);
+    Board b = s.keyframe.to_board();
+    const std::size_t steps = generation - s.start;
+    if (s.has_deltas) {
+        const std::uint32_t* cells = s.cells.data();
+        apply(b, cells, cells + (steps == 0 ? 0 : s.ends[steps - 1]));
+        return b;
+    }
+    Board tmp;
+    for (std::size_t i = 0; i < steps; ++i) {
+        b.tick_into(tmp, life_rule);
+        std::swap(b, tmp);
+    }
+    return b;
+}
+
+std::size_t History::segment_bytes(const Segment& s) noexcept
+{
+    return sizeof(Segment)
+         + s.keyframe.words.capacity()*sizeof(std::uint64_t)
+         + s.cells.capacity()*sizeof(std::uint32_t)
+         + s.ends.capacity()*sizeof(std::uint32_t);
+}
+
+std::size_t History::memory_usage() const noexcept
+{
+    std::size_t result = (last.brd.capacity() + scratch.brd.capacity())*sizeof(int)
+                       + flips.capacity()*sizeof(std::uint32_t);
+    for (const Segment& s : segments) {
+        result += segment_bytes(s);
+    }
+    return result;
+}
+
+void History::set_memory_budget(std::size_t bytes)
+{
+    budget = bytes;
+    enforce_budget();
+}
+
+// The newest segment is never thinned, so stepping back from the latest
+// generation stays cheap.
+void History::enforce_budget()
+{
+    std::size_t used = memory_usage();
+    for (std::size_t i = 0; used > budget && i + 1 < segments.size(); ++i) {
+        Segment& s = segments[i];
+        if (!s.has_deltas) {
+            continue;
+        }
+        used -= segment_bytes(s);
+        s.has_deltas = false;
+        s.cells = {};
+        s.ends = {};
+        used += segment_bytes(s);
+    }
+    while (used > budget && segments.size() > 2) {
+        // merge each odd old segment into the one before it
+        std::vector<Segment> kept;
+        kept.reserve(segments.size() / 2 + 2);
+        const std::size_t old = segments.size() - 1;
+        for (std::size_t i = 0; i < old; i += 2) {
+            Segment s = std::move(segments[i]);
+            if (i + 1 < old) {
+                s.length += segments[i + 1].length;
+                s.has_deltas = false;
+                s.cells = {};
+                s.ends = {};
+            }
+            kept.push_back(std::move(s));
+        }
+        kept.push_back(std::move(segments.back()));
+        if (kept.size() == segments.size()) {
+            break;
+        }
+        segments = std::move(kept);
+        used = memory_usage();
+    }
+}
+
+// Settings and generation, then each segment, then the latest board
+// bit-packed.  `scratch` and `flips` are not part of the state.
+void History::write(std::ostream& os) const
+{
+    put<std::int32_t>(os, interval);
+    put<std::uint64_t>(os, budget);
+    put<std::uint64_t>(os, gen);
+    put<std::int32_t>(os, last.nrows);
+    put<std::int32_t>(os, last.ncols);
+    put<std::uint64_t>(os, segments.size());
+    for (const Segment& s : segments) {
+        put<std::uint64_t>(os, s.start);
+        put<std::uint64_t>(os, s.length);
+        put<std::uint8_t>(os, s.has_deltas);
+        put_array(os, s.keyframe.words);
+        put_array(os, s.cells);
+        put_array(os, s.ends);
+    }
+    put_array(os, BitBoard(last).words);
+}
+
+// Checked well enough that at() and pop() stay within bounds on anything
+// read() accepts.
+History History::read(const char* data, std::size_t size, Rule rule)
+{
+    Reader in(data, size);
+    History h;
+    h.life_rule = rule;
+    h.interval = in.get<std::int32_t>();
+    h.budget = in.get<std::uint64_t>();
+    h.gen = in.get<std::uint64_t>();
+    const auto nrows = in.get<std::int32_t>();
+    const auto ncols = in.get<std::int32_t>();
+    if (h.interval < 1 || nrows < 0 || ncols < 0) {
+        Reader::fail();
+    }
+    const BitBoard shape(nrows, ncols);
+    const std::size_t ncells = static_cast<std::size_t>(nrows)*static_cast<std::size_t>(ncols);
+    const auto nsegments = in.get<std::uint64_t>();
+    std::size_t next_start = 0;
+    for (std::uint64_t i = 0; i < nsegments; ++i) {
+        Segment s;
+        s.start = in.get<std::uint64_t>();
+        s.length = in.get<std::uint64_t>();
+        s.has_deltas = in.get<std::uint8_t>() != 0;
+        s.keyframe = shape;
+        in.get_array(s.keyframe.words, in.get<std::uint64_t>());
+        in.get_array(s.cells, in.get<std::uint64_t>());
+        in.get_array(s.ends, in.get<std::uint64_t>());
+        const bool deltas_ok = s.has_deltas
+            ? s.ends.size() + 1 == s.length
+              && std::is_sorted(s.ends.begin(), s.ends.end())
+              && (s.ends.empty() ? s.cells.empty() : s.ends.back() == s.cells.size())
+              && std::all_of(s.cells.begin(), s.cells.end(), [&](std::uint32_t c) { return c < ncells; })
+            : s.cells.empty() && s.ends.empty();
+        if (s.start != next_start || s.length == 0 || !deltas_ok
+                || s.keyframe.words.size() != shape.words.size()) {
+            Reader::fail();
+        }
+        next_start = s.start + s.length;
+        h.segments.push_back(std::move(s));
+    }
+    BitBoard latest = shape;
+    in.get_array(latest.words, in.get<std::uint64_t>());
+    if (h.segments.empty() || next_start != h.gen + 1 || latest.words.size() != shape.words.size() || !in.done()) {
+        Reader::fail();
+    }
+    h.last = latest.to_board();
+    return h;
+}
+
+} // namespace gol
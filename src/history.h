@@ -0,0 +1,86 @@
+#pragma once
+
+#include "bitboard.h"
+#include "golife.h"
+#include "rule.h"
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+namespace gol {
+
+// Generation history for stepping back and scrubbing.  Every
+// `keyframe_interval` generations a bit-packed keyframe is stored, and the
+// generations in between are kept as the list of cells that flipped.  The
+// latest generation is always held in full.  Every generation follows
+// from the one before under a single rule, which re-simulation uses too.
+//
+// When the memory budget is exceeded the oldest deltas are dropped first;
+// those generations are then re-simulated from their keyframe on access.
+// If that is still not enough, every other old keyframe is dropped, which
+// doubles the re-simulation distance for that part of the history.
+class History
+{
+public:
+    static constexpr int DEFAULT_KEYFRAME_INTERVAL = 64;
+    static constexpr std::size_t DEFAULT_MEMORY_BUDGET = std::size_t{256} << 20;
+
+    History() = default;
+    explicit History(Board initial, Rule rule = {},
+            int keyframe_interval = DEFAULT_KEYFRAME_INTERVAL,
+            std::size_t memory_budget = DEFAULT_MEMORY_BUDGET);
+
+    void reset(Board initial, Rule rule = {});
+    void push(Board next);
+    void advance();
+    void pop();
+
+    // Generation number of latest(); the history holds generations
+    // [0, generation()].
+    std::size_t generation() const noexcept { return gen; }
+    std::size_t size() const noexcept { return gen + 1; }
+    Rule rule() const noexcept { return life_rule; }
+    const Board& latest() const noexcept { return last; }
+    Board at(std::size_t generation) const;
+    // Cells that flipped to produce latest(), empty after pop() or reset().
+    const std::vector<std::uint32_t>& last_flips() const noexcept { return flips; }
+
+    std::size_t memory_usage() const noexcept;
+    std::size_t memory_budget() const noexcept { return budget; }
+    void set_memory_budget(std::size_t bytes);
+
+    // Binary form for checkpoints, little-endian.  read() takes exactly
+    // what write() produced and throws std::runtime_error on anything
+    // malformed.  The rule is not part of it; checkpoints keep that in
+    // their header.
+    void write(std::ostream& os) const;
+    static History read(const char* data, std::size_t size, Rule rule = {});
+
+private:
+    struct Segment
+    {
+        std::size_t start = 0;
+        std::size_t length = 1;
+        BitBoard keyframe = {};
+        bool has_deltas = true;
+        std::vector<std::uint32_t> cells = {};
+        std::vector<std::uint32_t> ends = {};
+    };
+
+    const Segment& segment_for(std::size_t generation) const noexcept;
+    void commit();
+    void enforce_budget();
+    static std::size_t segment_bytes(const Segment& s) noexcept;
+
+    std::vector<Segment> segments;
+    Board last = {};
+    Board scratch = {};
+    std::vector<std::uint32_t> flips;
+    std::size_t gen = 0;
+    Rule life_rule = {};
+    int interval = DEFAULT_KEYFRAME_INTERVAL;
+    std::size_t budget = DEFAULT_MEMORY_BUDGET;
+};
+
+} // namespace gol
@@ -0,0 +1,436 @@
+#include "kernels.h"
+#include "golife.h"
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GOL_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace gol {
+
+namespace {
+
+// 3x3 totals, centre included, that leave a cell live next generation:
+// `any` whatever its current state, `born` only if it is dead and `stay`
+// only if it is live.  For B3/S23 that is any = {3} and stay = {4}.
+template <class R>
+struct Totals
+{
+    static constexpr unsigned birth = R::birth;
+    static constexpr unsigned survive = static_cast<unsigned>(R::survive) << 1;
+    static constexpr unsigned any = birth & survive;
+    static constexpr unsigned born = birth & ~survive;
+    static constexpr unsigned stay = survive & ~birth;
+};
+
+template <class R>
+void tick_rows_scalar(const Board& cur, Board& next, int y0, int y1, R rule) noexcept
+{
+    for (int y = y0; y < y1; ++y) {
+        for (int x = 0; x < cur.ncols; ++x) {
+            const int ns = cur.live_neighbors(x, y);
+            const unsigned mask = cur.live(x, y) ? rule.survive : rule.birth;
+            if ((mask >> ns) & 1) {
+                next.set_live(x, y);
+            } else {
+                next.set_dead(x, y);
+            }
+        }
+    }
+}
+
+// The row kernels work a row at a time.  `vsum` holds the column sums of
+// the rows above, at and below y, padded with a dead column on either
+// side, so the 3x3 total for cell x is vsum[x] + vsum[x+1] + vsum[x+2].
+
+struct RowPtrs
+{
+    const int* up;
+    const int* cur;
+    const int* down;
+    int* out;
+    int* vsum;
+};
+
+int* scratch_row(int ncols)
+{
+    thread_local std::vector<int> vsum;
+    if (vsum.size() < static_cast<std::size_t>(ncols) + 2) {
+        vsum.resize(static_cast<std::size_t>(ncols) + 2);
+    }
+    return vsum.data();
+}
+
+RowPtrs row_ptrs(const Board& cur, Board& next, int y, int* vsum) noexcept
+{
+    const int* base = cur.brd.data();
+    const int n = cur.ncols;
+    return {
+        y > 0 ? base + (y - 1)*n : nullptr,
+        base + y*n,
+        y + 1 < cur.nrows ? base + (y + 1)*n : nullptr,
+        next.brd.data() + y*n,
+        vsum,
+    };
+}
+
+void column_sums_tail(const RowPtrs& r, int x, int n) noexcept
+{
+    for (; x < n; ++x) {
+        r.vsum[x + 1] = (r.up ? r.up[x] : 0) + r.cur[x] + (r.down ? r.down[x] : 0);
+    }
+}
+
+template <class R>
+void row_tail(const RowPtrs& r, int x, int n) noexcept
+{
+    constexpr unsigned if_live = Totals<R>::any | Totals<R>::stay;
+    constexpr unsigned if_dead = Totals<R>::any | Totals<R>::born;
+    for (; x < n; ++x) {
+        const int total = r.vsum[x] + r.vsum[x + 1] + r.vsum[x + 2];
+        const unsigned mask = r.cur[x] == Board::LIVE ? if_live : if_dead;
+        r.out[x] = (mask >> total) & 1 ? Board::LIVE : Board::DEAD;
+    }
+}
+
+// Rules only known at run time: the same column sums, then a lookup in a
+// table indexed by the cell's state and its 3x3 total.
+void tick_rows_table(Rule rule, const Board& cur, Board& next, int y0, int y1) noexcept
+{
+    int table[2][10];
+    for (int t = 0; t < 10; ++t) {
+        table[Board::DEAD][t] = t <= 8 && (rule.birth >> t) & 1 ? Board::LIVE : Board::DEAD;
+        table[Board::LIVE][t] = t >= 1 && (rule.survive >> (t - 1)) & 1 ? Board::LIVE : Board::DEAD;
+    }
+    const int n = cur.ncols;
+    int* vsum = scratch_row(n);
+    for (int y = y0; y < y1; ++y) {
+        const RowPtrs r = row_ptrs(cur, next, y, vsum);
+        r.vsum[0] = r.vsum[n + 1] = 0;
+        column_sums_tail(r, 0, n);
+        for (int x = 0; x < n; ++x) {
+            r.out[x] = table[r.cur[x]][r.vsum[x] + r.vsum[x + 1] + r.vsum[x + 2]];
+        }
+    }
+}
+
+#ifdef GOL_X86_KERNELS
+
+// With the centre included, the vector kernels compare the 3x3 totals
+// against the Totals<R> sets, which are constants for each instantiation.
+// For B3/S23 that is one comparison for `any` and one for `stay`.
+
+__attribute__((target("sse2")))
+inline __m128i load128(const int* p) noexcept
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+__attribute__((target("sse2")))
+inline void store128(int* p, __m128i v) noexcept
+{
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+}
+
+__attribute__((target("avx2")))
+inline __m256i load256(const int* p) noexcept
+{
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+__attribute__((target("avx2")))
+inline void store256(int* p, __m256i v) noexcept
+{
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+}
+
+// Lanes of `t` equal to any of the totals in Mask, all ones or all zeros.
+template <unsigned Mask, int T = 0>
+__attribute__((target("sse2")))
+inline __m128i match_sse2(__m128i t) noexcept
+{
+    if constexpr (T > 9) {
+        return _mm_setzero_si128();
+    } else if constexpr (((Mask >> T) & 1) == 0) {
+        return match_sse2<Mask, T + 1>(t);
+    } else if constexpr ((Mask >> (T + 1)) == 0) {
+        return _mm_cmpeq_epi32(t, _mm_set1_epi32(T));
+    } else {
+        return _mm_or_si128(_mm_cmpeq_epi32(t, _mm_set1_epi32(T)), match_sse2<Mask, T + 1>(t));
+    }
+}
+
+template <unsigned Mask, int T = 0>
+__attribute__((target("avx2")))
+inline __m256i match_avx2(__m256i t) noexcept
+{
+    if constexpr (T > 9) {
+        return _mm256_setzero_si256();
+    } else if constexpr (((Mask >> T) & 1) == 0) {
+        return match_avx2<Mask, T + 1>(t);
+    } else if constexpr ((Mask >> (T + 1)) == 0) {
+        return _mm256_cmpeq_epi32(t, _mm256_set1_epi32(T));
+    } else {
+        return _mm256_or_si256(_mm256_cmpeq_epi32(t, _mm256_set1_epi32(T)), match_avx2<Mask, T + 1>(t));
+    }
+}
+
+// Lanes of `t` selected by `k` and equal to any of the totals in Mask.
+template <unsigned Mask, int T = 0>
+__attribute__((target("avx512f")))
+inline __mmask16 match_avx512(__mmask16 k, __m512i t) noexcept
+{
+    if constexpr (T > 9) {
+        return 0;
+    } else if constexpr (((Mask >> T) & 1) == 0) {
+        return match_avx512<Mask, T + 1>(k, t);
+    } else if constexpr ((Mask >> (T + 1)) == 0) {
+        return _mm512_mask_cmpeq_epi32_mask(k, t, _mm512_set1_epi32(T));
+    } else {
+        return _mm512_mask_cmpeq_epi32_mask(k, t, _mm512_set1_epi32(T)) | match_avx512<Mask, T + 1>(k, t);
+    }
+}
+
+template <class R>
+__attribute__((target("sse2")))
+void row_sse2(const RowPtrs& r, int n) noexcept
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one  = _mm_set1_epi32(1);
+
+    r.vsum[0] = r.vsum[n + 1] = 0;
+    int x = 0;
+    for (; x + 4 <= n; x += 4) {
+        __m128i s = load128(r.cur + x);
+        s = _mm_add_epi32(s, r.up   ? load128(r.up + x)   : zero);
+        s = _mm_add_epi32(s, r.down ? load128(r.down + x) : zero);
+        store128(r.vsum + x + 1, s);
+    }
+    column_sums_tail(r, x, n);
+
+    for (x = 0; x + 4 <= n; x += 4) {
+        const __m128i t = _mm_add_epi32(_mm_add_epi32(load128(r.vsum + x), load128(r.vsum + x + 1)), load128(r.vsum + x + 2));
+        __m128i next = match_sse2<Totals<R>::any>(t);
+        if constexpr (Totals<R>::born != 0 || Totals<R>::stay != 0) {
+            const __m128i live = _mm_cmpeq_epi32(load128(r.cur + x), one);
+            if constexpr (Totals<R>::born != 0) {
+                next = _mm_or_si128(next, _mm_andnot_si128(live, match_sse2<Totals<R>::born>(t)));
+            }
+            if constexpr (Totals<R>::stay != 0) {
+                next = _mm_or_si128(next, _mm_and_si128(live, match_sse2<Totals<R>::stay>(t)));
+            }
+        }
+        store128(r.out + x, _mm_and_si128(next, one));
+    }
+    row_tail<R>(r, x, n);
+}
+
+template <class R>
+__attribute__((target("avx2")))
+void row_avx2(const RowPtrs& r, int n) noexcept
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one  = _mm256_set1_epi32(1);
+
+    r.vsum[0] = r.vsum[n + 1] = 0;
+    int x = 0;
+    for (; x + 8 <= n; x += 8) {
+        __m256i s = load256(r.cur + x);
+        s = _mm256_add_epi32(s, r.up   ? load256(r.up + x)   : zero);
+        s = _mm256_add_epi32(s, r.down ? load256(r.down + x) : zero);
+        store256(r.vsum + x + 1, s);
+    }
+    column_sums_tail(r, x, n);
+
+    for (x = 0; x + 8 <= n; x += 8) {
+        const __m256i t = _mm256_add_epi32(_mm256_add_epi32(load256(r.vsum + x), load256(r.vsum + x + 1)), load256(r.vsum + x + 2));
+        __m256i next = match_avx2<Totals<R>::any>(t);
+        if constexpr (Totals<R>::born != 0 || Totals<R>::stay != 0) {
+            const __m256i live = _mm256_cmpeq_epi32(load256(r.cur + x), one);
+            if constexpr (Totals<R>::born != 0) {
+                next = _mm256_or_si256(next, _mm256_andnot_si256(live, match_avx2<Totals<R>::born>(t)));
+            }
+            if constexpr (Totals<R>::stay != 0) {
+                next = _mm256_or_si256(next, _mm256_and_si256(live, match_avx2<Totals<R>::stay>(t)));
+            }
+        }
+        store256(r.out + x, _mm256_and_si256(next, one));
+    }
+    row_tail<R>(r, x, n);
+}
+
+template <class R>
+__attribute__((target("avx512f")))
+void row_avx512(const RowPtrs& r, int n) noexcept
+{
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i one  = _mm512_set1_epi32(1);
+
+    r.vsum[0] = r.vsum[n + 1] = 0;
+    int x = 0;
+    for (; x + 16 <= n; x += 16) {
+        __m512i s = _mm512_loadu_si512(r.cur + x);
+        s = _mm512_add_epi32(s, r.up   ? _mm512_loadu_si512(r.up + x)   : zero);
+        s = _mm512_add_epi32(s, r.down ? _mm512_loadu_si512(r.down + x) : zero);
+        _mm512_storeu_si512(r.vsum + x + 1, s);
+    }
+    column_sums_tail(r, x, n);
+
+    for (x = 0; x + 16 <= n; x += 16) {
+        const __m512i t = _mm512_add_epi32(_mm512_add_epi32(
+                    _mm512_loadu_si512(r.vsum + x), _mm512_loadu_si512(r.vsum + x + 1)),
+                    _mm512_loadu_si512(r.vsum + x + 2));
+        __mmask16 next = match_avx512<Totals<R>::any>(0xffff, t);
+        if constexpr (Totals<R>::born != 0 || Totals<R>::stay != 0) {
+            const __mmask16 live = _mm512_cmpeq_epi32_mask(_mm512_loadu_si512(r.cur + x), one);
+            if constexpr (Totals<R>::born != 0) {
+                next |= match_avx512<Totals<R>::born>(static_cast<__mmask16>(~live), t);
+            }
+            if constexpr (Totals<R>::stay != 0) {
+                next |= match_avx512<Totals<R>::stay>(live, t);
+            }
+        }
+        _mm512_storeu_si512(r.out + x, _mm512_maskz_mov_epi32(next, one));
+    }
+    row_tail<R>(r, x, n);
+}
+
+template <void (*Row)(const RowPtrs&, int) noexcept>
+void tick_rows_vector(const Board& cur, Board& next, int y0, int y1) noexcept
+{
+    int* vsum = scratch_row(cur.ncols);
+    for (int y = y0; y < y1; ++y) {
+        Row(row_ptrs(cur, next, y, vsum), cur.ncols);
+    }
+}
+
+#endif // GOL_X86_KERNELS
+
+template <class R>
+void tick_rows_fixed(Kernel k, const Board& cur, Board& next, int y0, int y1) noexcept
+{
+    switch (k) {
+#ifdef GOL_X86_KERNELS
+        case Kernel::SSE2:
+            tick_rows_vector<row_sse2<R>>(cur, next, y0, y1);
+            return;
+        case Kernel::AVX2:
+            tick_rows_vector<row_avx2<R>>(cur, next, y0, y1);
+            return;
+        case Kernel::AVX512:
+            tick_rows_vector<row_avx512<R>>(cur, next, y0, y1);
+            return;
+#endif
+        default:
+            tick_rows_scalar(cur, next, y0, y1, R{});
+            return;
+    }
+}
+
+Kernel kernel_from_env() noexcept
+{
+    Kernel k;
+    const char* name = std::getenv("GOL_KERNEL");
+    if (name && parse_kernel(name, &k) && kernel_supported(k)) {
+        return k;
+    }
+    return best_kernel();
+}
+
+std::atomic<Kernel>& current_kernel() noexcept
+{
+    static std::atomic<Kernel> kernel{kernel_from_env()};
+    return kernel;
+}
+
+} // namespace
+
+const char* kernel_name(Kernel k) noexcept
+{
+    switch (k) {
+        case Kernel::Scalar: return "scalar";
+        case Kernel::SSE2:   return "sse2";
+        case Kernel::AVX2:   return "avx2";
+        case Kernel::AVX512: return "avx512";
+    }
+    return "unknown";
+}
+
+bool parse_kernel(const char* name, Kernel* k) noexcept
+{
+    for (Kernel cand : { Kernel::Scalar, Kernel::SSE2, Kernel::AVX2, Kernel::AVX512 }) {
+        if (std::strcmp(name, kernel_name(cand)) == 0) {
+            *k = cand;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool kernel_supported(Kernel k) noexcept
+{
+    switch (k) {
+        case Kernel::Scalar:
+            return true;
+#ifdef GOL_X86_KERNELS
+        case Kernel::SSE2:
+            return __builtin_cpu_supports("sse2");
+        case Kernel::AVX2:
+            return __builtin_cpu_supports("avx2");
+        case Kernel::AVX512:
+            return __builtin_cpu_supports("avx512f");
+#else
+        default:
+            return false;
+#endif
+    }
+    return false;
+}
+
+Kernel best_kernel() noexcept
+{
+    for (Kernel k : { Kernel::AVX512, Kernel::AVX2, Kernel::SSE2 }) {
+        if (kernel_supported(k)) {
+            return k;
+        }
+    }
+    return Kernel::Scalar;
+}
+
+Kernel active_kernel() noexcept
+{
+    return current_kernel().load(std::memory_order_relaxed);
+}
+
+bool set_kernel(Kernel k) noexcept
+{
+    if (!kernel_supported(k)) {
+        return false;
+    }
+    current_kernel().store(k, std::memory_order_relaxed);
+    return true;
+}
+
+void tick_rows(const Board& cur, Board& next, int y0, int y1, Rule rule) noexcept
+{
+    tick_rows(active_kernel(), cur, next, y0, y1, rule);
+}
+
+void tick_rows(Kernel k, const Board& cur, Board& next, int y0, int y1, Rule rule) noexcept
+{
+    assert(next.nrows == cur.nrows && next.ncols == cur.ncols);
+    assert(0 <= y0 && y0 <= y1 && y1 <= cur.nrows);
+    const bool fixed = with_fixed_rule(rule, [&](auto r) {
+        tick_rows_fixed<decltype(r)>(k, cur, next, y0, y1);
+    });
+    if (!fixed) {
+        tick_rows_table(rule, cur, next, y0, y1);
+    }
+}
+
+} // namespace gol
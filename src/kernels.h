@@ -0,0 +1,34 @@
+#pragma once
+
+#include "rule.h"
+
+namespace gol {
+
+struct Board;
+
+// Row kernels used by Board::tick().  The best kernel the CPU supports is
+// chosen on first use; setting GOL_KERNEL=scalar|sse2|avx2|avx512 in the
+// environment, or calling set_kernel(), forces a specific one.
+enum class Kernel
+{
+    Scalar,
+    SSE2,
+    AVX2,
+    AVX512,
+};
+
+const char* kernel_name(Kernel k) noexcept;
+bool parse_kernel(const char* name, Kernel* k) noexcept;
+bool kernel_supported(Kernel k) noexcept;
+Kernel best_kernel() noexcept;
+Kernel active_kernel() noexcept;
+bool set_kernel(Kernel k) noexcept;
+
+// Write rows [y0, y1) of the generation after `cur` into `next`, which
+// must have the same dimensions.  An explicitly chosen kernel must be
+// supported by the CPU.  The rules listed in rule.h run kernels
+// specialized for them; any other rule uses a table-driven scalar kernel.
+void tick_rows(const Board& cur, Board& next, int y0, int y1, Rule rule = {}) noexcept;
+void tick_rows(Kernel k, const Board& cur, Board& next, int y0, int y1, Rule rule = {}) noexcept;
+
+} // namespace gol
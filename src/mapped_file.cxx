@@ -0,0 +1,71 @@
+#include "mapped_file.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace gol {
+
+MappedFile::MappedFile(const std::string& path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("cannot open " + path + ": " + std::strerror(errno));
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        const int err = errno;
+        ::close(fd);
+        throw std::runtime_error("cannot stat " + path + ": " + std::strerror(err));
+    }
+    len = static_cast<std::size_t>(st.st_size);
+    if (len != 0) {
+        void* p = ::mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            const int err = errno;
+            ::close(fd);
+            len = 0;
+            throw std::runtime_error("cannot map " + path + ": " + std::strerror(err));
+        }
+        // One front-to-back pass: let the kernel read ahead aggressively.
+        ::madvise(p, len, MADV_SEQUENTIAL);
+        ptr = static_cast<const char*>(p);
+    }
+    ::close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    unmap();
+}
+
+MappedFile::MappedFile(MappedFile&& o) noexcept
+    : ptr{std::exchange(o.ptr, nullptr)}, len{std::exchange(o.len, 0)}
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& o) noexcept
+{
+    if (this != &o) {
+        unmap();
+        ptr = std::exchange(o.ptr, nullptr);
+        len = std::exchange(o.len, 0);
+    }
+    return *this;
+}
+
+void MappedFile::unmap() noexcept
+{
+    if (ptr) {
+        ::munmap(const_cast<char*>(ptr), len);
+        ptr = nullptr;
+        len = 0;
+    }
+}
+
+} // namespace gol
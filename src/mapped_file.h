@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace gol {
+
+// Read-only memory mapping of a whole file.  The pages are faulted in on
+// demand, so parsers can walk a multi-gigabyte file front to back without
+// copying it into a buffer first.
+class MappedFile
+{
+public:
+    MappedFile() noexcept = default;
+    // Throw std::runtime_error if the file cannot be opened or mapped.
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+    MappedFile(MappedFile&& o) noexcept;
+    MappedFile& operator=(MappedFile&& o) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const noexcept { return ptr; }
+    std::size_t size() const noexcept { return len; }
+    const char* begin() const noexcept { return ptr; }
+    const char* end() const noexcept { return ptr + len; }
+
+private:
+    void unmap() noexcept;
+
+    const char* ptr = nullptr;
+    std::size_t len = 0;
+};
+
+} // namespace gol
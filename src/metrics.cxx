@@ -0,0 +1,338 @@
+#include "metrics.h"
+#include "bitboard.h"
+#include "golife.h"
+#include "halo.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+
+namespace gol {
+
+void LatencyHistogram::record(std::chrono::nanoseconds latency) noexcept
+{
+    const auto ns = static_cast<std::uint64_t>(std::max<std::int64_t>(latency.count(), 0));
+    const int width = ns ? 64 - __builtin_clzll(ns) : 0;
+    ++counts[static_cast<std::size_t>(std::min(width, BUCKETS - 1))];
+    ++n;
+    total += ns;
+    lo = std::min(lo, ns);
+    hi = std::max(hi, ns);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) noexcept
+{
+    for (std::size_t i = 0; i < counts.size(); ++i) {
+        counts[i] += other.counts[i];
+    }
+    n += other.n;
+    total += other.total;
+    lo = std::min(lo, other.lo);
+    hi = std::max(hi, other.hi);
+}
+
+std::chrono::nanoseconds LatencyHistogram::min() const noexcept
+{
+    return std::chrono::nanoseconds(n ? lo : 0);
+}
+
+std::chrono::nanoseconds LatencyHistogram::mean() const noexcept
+{
+    return std::chrono::nanoseconds(n ? total / n : 0);
+}
+
+std::chrono::nanoseconds LatencyHistogram::quantile(double q) const noexcept
+{
+    if (n == 0) {
+        return std::chrono::nanoseconds(0);
+    }
+    const double rank = std::ceil(std::clamp(q, 0.0, 1.0) * static_cast<double>(n));
+    const auto target = std::max<std::uint64_t>(static_cast<std::uint64_t>(rank), 1);
+    std::uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; ++i) {
+        seen += counts[static_cast<std::size_t>(i)];
+        if (seen >= target) {
+            return std::min(bucket_limit(i), max());
+        }
+    }
+    return max();
+}
+
+std::chrono::nanoseconds LatencyHistogram::bucket_limit(int i) noexcept
+{
+    assert(i >= 0 && i < BUCKETS);
+    return std::chrono::nanoseconds(std::int64_t{1} << i);
+}
+
+Activity activity(const Board& prev, const Board& next) noexcept
+{
+    assert(prev.brd.size() == next.brd.size());
+    // cells are 0 or 1, so these sums vectorize without branches
+    std::int64_t population = 0;
+    std::int64_t births = 0;
+    std::int64_t deaths = 0;
+    for (std::size_t i = 0; i < next.brd.size(); ++i) {
+        const int a = prev.brd[i];
+        const int b = next.brd[i];
+        population += b;
+        births += b & ~a;
+        deaths += a & ~b;
+    }
+    return {population, births, deaths};
+}
+
+Activity activity(const BitBoard& prev, const BitBoard& next) noexcept
+{
+    return activity(prev.view(), next.view());
+}
+
+Activity activity(const BitBoardView& prev, const BitBoardView& next) noexcept
+{
+    assert(prev.nrows == next.nrows && prev.nwords == next.nwords);
+    const std::size_t n = static_cast<std::size_t>(next.nrows)*static_cast<std::size_t>(next.nwords);
+    std::int64_t population = 0;
+    std::int64_t births = 0;
+    std::int64_t deaths = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        const std::uint64_t a = prev.words[i];
+        const std::uint64_t b = next.words[i];
+        population += __builtin_popcountll(b);
+        births += __builtin_popcountll(b & ~a);
+        deaths += __builtin_popcountll(a & ~b);
+    }
+    return {population, births, deaths};
+}
+
+Activity activity(const HaloBoard& prev, const HaloBoard& next) noexcept
+{
+    assert(prev.nrows() == next.nrows() && prev.ncols() == next.ncols());
+    std::int64_t population = 0;
+    std::int64_t births = 0;
+    std::int64_t deaths = 0;
+    for (int y = 0; y < next.nrows(); ++y) {
+        const std::uint8_t* a = prev.row(y);
+        const std::uint8_t* b = next.row(y);
+        for (int x = 0; x < next.ncols(); ++x) {
+            population += b[x];
+            births += b[x] & ~a[x];
+            deaths += a[x] & ~b[x];
+        }
+    }
+    return {population, births, deaths};
+}
+
+void TickMetrics::record(const TickSample& s) noexcept
+{
+    hist.record(s.latency);
+    if (s.change.known()) {
+        total_births += s.change.births;
+        total_deaths += s.change.deaths;
+    }
+    ring[head] = s;
+    head = (head + 1) % RECENT;
+    size = std::min(size + 1, RECENT);
+}
+
+void TickMetrics::reset() noexcept
+{
+    *this = TickMetrics();
+}
+
+std::vector<TickSample> TickMetrics::recent() const
+{
+    std::vector<TickSample> out;
+    out.reserve(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        out.push_back(ring[(head + RECENT - size + i) % RECENT]);
+    }
+    return out;
+}
+
+const TickSample* TickMetrics::last() const noexcept
+{
+    return size ? &ring[(head + RECENT - 1) % RECENT] : nullptr;
+}
+
+namespace {
+
+// One per thread, on its own cache line.  Only the owning thread writes,
+// so a relaxed load and store stand in for a locked increment; the
+// atomics are there for tick_counters() reading from another thread.
+struct alignas(64) CounterSlot
+{
+    std::atomic<std::uint64_t> generations{0};
+    std::atomic<std::uint64_t> cells{0};
+};
+
+// Slots of the live threads, plus what exited threads had counted.
+struct CounterRegistry
+{
+    std::mutex mtx;
+    std::vector<CounterSlot*> slots;
+    TickCounters retired;
+};
+
+CounterRegistry& registry()
+{
+    static CounterRegistry r;
+    return r;
+}
+
+// Registration is the only locking, once when a thread first ticks and
+// once when it exits.
+struct LocalCounters
+{
+    CounterSlot slot;
+
+    LocalCounters()
+    {
+        CounterRegistry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mtx);
+        r.slots.push_back(&slot);
+    }
+
+    ~LocalCounters()
+    {
+        CounterRegistry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mtx);
+        r.retired.generations += slot.generations.load(std::memory_order_relaxed);
+        r.retired.cells += slot.cells.load(std::memory_order_relaxed);
+        r.slots.erase(std::find(r.slots.begin(), r.slots.end(), &slot));
+    }
+};
+
+CounterSlot& local_counters()
+{
+    thread_local LocalCounters local;
+    return local.slot;
+}
+
+void bump(std::atomic<std::uint64_t>& counter, std::uint64_t n) noexcept
+{
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+} // namespace
+
+void count_generation() noexcept
+{
+    bump(local_counters().generations, 1);
+}
+
+void count_cells(std::uint64_t n) noexcept
+{
+    bump(local_counters().cells, n);
+}
+
+TickCounters tick_counters()
+{
+    CounterRegistry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mtx);
+    TickCounters total = r.retired;
+    for (const CounterSlot* slot : r.slots) {
+        total.generations += slot->generations.load(std::memory_order_relaxed);
+        total.cells += slot->cells.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+namespace {
+
+void write_count(std::ostream& os, std::int64_t n, const char* unknown)
+{
+    if (n >= 0) {
+        os << n;
+    } else {
+        os << unknown;
+    }
+}
+
+} // namespace
+
+void write_metrics_csv(std::ostream& os, const std::vector<TickSample>& samples)
+{
+    os << "generation,latency_ns,population,births,deaths,changed\n";
+    for (const TickSample& s : samples) {
+        os << s.generation << ',' << s.latency.count() << ',' << s.change.population << ',';
+        write_count(os, s.change.births, "");
+        os << ',';
+        write_count(os, s.change.deaths, "");
+        os << ',';
+        write_count(os, s.change.changed(), "");
+        os << '\n';
+    }
+}
+
+void write_metrics_json(std::ostream& os, const TickMetrics& metrics, const std::vector<TickSample>& samples)
+{
+    const LatencyHistogram& h = metrics.latency();
+    const TickCounters counters = tick_counters();
+
+    os << "{\n";
+    os << "  \"latency_ns\": {\n";
+    os << "    \"count\": " << h.count() << ",\n";
+    os << "    \"min\": " << h.min().count() << ",\n";
+    os << "    \"mean\": " << h.mean().count() << ",\n";
+    os << "    \"p50\": " << h.quantile(0.5).count() << ",\n";
+    os << "    \"p90\": " << h.quantile(0.9).count() << ",\n";
+    os << "    \"p99\": " << h.quantile(0.99).count() << ",\n";
+    os << "    \"max\": " << h.max().count() << ",\n";
+    os << "    \"buckets\": [";
+    bool first = true;
+    for (int i = 0; i < LatencyHistogram::BUCKETS; ++i) {
+        const std::uint64_t c = h.buckets()[static_cast<std::size_t>(i)];
+        if (c == 0) {
+            continue;
+        }
+        os << (first ? "" : ", ") << "{\"below\": " << LatencyHistogram::bucket_limit(i).count()
+           << ", \"count\": " << c << "}";
+        first = false;
+    }
+    os << "]\n";
+    os << "  },\n";
+    os << "  \"births\": " << metrics.births() << ",\n";
+    os << "  \"deaths\": " << metrics.deaths() << ",\n";
+    os << "  \"counters\": {\"generations\": " << counters.generations
+       << ", \"cells\": " << counters.cells << "},\n";
+    os << "  \"generations\": [";
+    first = true;
+    for (const TickSample& s : samples) {
+        os << (first ? "\n" : ",\n");
+        os << "    {\"generation\": " << s.generation
+           << ", \"latency_ns\": " << s.latency.count()
+           << ", \"population\": " << s.change.population
+           << ", \"births\": ";
+        write_count(os, s.change.births, "null");
+        os << ", \"deaths\": ";
+        write_count(os, s.change.deaths, "null");
+        os << ", \"changed\": ";
+        write_count(os, s.change.changed(), "null");
+        os << "}";
+        first = false;
+    }
+    os << (first ? "]\n" : "\n  ]\n");
+    os << "}\n";
+}
+
+void save_metrics(const std::string& path, const TickMetrics& metrics, const std::vector<TickSample>& samples)
+{
+    std::ofstream os(path);
+    if (!os) {
+        throw std::runtime_error("cannot open output file: " + path);
+    }
+    const std::string ext = ".json";
+    if (path.size() >= ext.size() && path.compare(path.size() - ext.size(), ext.size(), ext) == 0) {
+        write_metrics_json(os, metrics, samples);
+    } else {
+        write_metrics_csv(os, samples);
+    }
+    if (!os.flush()) {
+        throw std::runtime_error("error writing " + path);
+    }
+}
+
+} // namespace gol
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace gol {
+
+struct Board;
+struct BitBoard;
+struct BitBoardView;
+class HaloBoard;
+
+// Tick latencies in power-of-two buckets: bucket i counts latencies below
+// 2^i ns (and at least 2^(i-1) ns), the last one everything longer.
+// Recording is a handful of integer operations, so it can stay on for
+// every generation.
+class LatencyHistogram
+{
+public:
+    static constexpr int BUCKETS = 40; // up to about 9 minutes
+
+    void record(std::chrono::nanoseconds latency) noexcept;
+    void merge(const LatencyHistogram& other) noexcept;
+
+    std::uint64_t count() const noexcept { return n; }
+    std::chrono::nanoseconds min() const noexcept;
+    std::chrono::nanoseconds max() const noexcept { return std::chrono::nanoseconds(hi); }
+    std::chrono::nanoseconds mean() const noexcept;
+    // Upper bound of the bucket holding the q-quantile, q in [0, 1],
+    // clamped to the largest latency seen.
+    std::chrono::nanoseconds quantile(double q) const noexcept;
+
+    const std::array<std::uint64_t, BUCKETS>& buckets() const noexcept { return counts; }
+    static std::chrono::nanoseconds bucket_limit(int i) noexcept;
+
+private:
+    std::array<std::uint64_t, BUCKETS> counts = {};
+    std::uint64_t n = 0;
+    std::uint64_t total = 0;
+    std::uint64_t lo = UINT64_MAX;
+    std::uint64_t hi = 0;
+};
+
+// What one generation changed.  Engines that cannot tell cheaply which
+// cells flipped report -1 births and deaths.
+struct Activity
+{
+    std::int64_t population = 0;
+    std::int64_t births = 0;
+    std::int64_t deaths = 0;
+
+    bool known() const noexcept { return births >= 0; }
+    std::int64_t changed() const noexcept { return known() ? births + deaths : -1; }
+};
+
+// Compare two consecutive generations of the same size.
+Activity activity(const Board& prev, const Board& next) noexcept;
+Activity activity(const BitBoard& prev, const BitBoard& next) noexcept;
+Activity activity(const BitBoardView& prev, const BitBoardView& next) noexcept;
+Activity activity(const HaloBoard& prev, const HaloBoard& next) noexcept;
+
+struct TickSample
+{
+    std::uint64_t generation = 0;
+    std::chrono::nanoseconds latency{0};
+    Activity change;
+};
+
+// Per-generation metrics of one simulation.  Only the thread stepping it
+// records; a reader gets a copy, e.g. through a TripleBuffer snapshot, so
+// nothing on the tick path takes a lock.
+class TickMetrics
+{
+public:
+    static constexpr std::size_t RECENT = 256;
+
+    void record(const TickSample& s) noexcept;
+    void reset() noexcept;
+
+    const LatencyHistogram& latency() const noexcept { return hist; }
+    std::uint64_t ticks() const noexcept { return hist.count(); }
+    std::int64_t births() const noexcept { return total_births; }
+    std::int64_t deaths() const noexcept { return total_deaths; }
+    // The last RECENT samples, oldest first.
+    std::vector<TickSample> recent() const;
+    const TickSample* last() const noexcept;
+
+private:
+    LatencyHistogram hist;
+    std::array<TickSample, RECENT> ring = {};
+    std::size_t head = 0; // next slot to write
+    std::size_t size = 0;
+    std::int64_t total_births = 0;
+    std::int64_t total_deaths = 0;
+};
+
+// Work done by the tick kernels.  Each thread counts into its own
+// counters, which the threads doing the work update without locking or
+// sharing cache lines; tick_counters() sums them over every thread that
+// has ever ticked.
+struct TickCounters
+{
+    std::uint64_t generations = 0;
+    std::uint64_t cells = 0; // cells computed, counting each generation
+};
+
+void count_generation() noexcept;
+void count_cells(std::uint64_t n) noexcept;
+TickCounters tick_counters();
+
+// One row per sample: generation, latency_ns, population, births, deaths,
+// changed; unknown counts are left empty.
+void write_metrics_csv(std::ostream& os, const std::vector<TickSample>& samples);
+// The latency summary and histogram of `metrics`, the tick counters, and
+// `samples` as an array of per-generation objects.
+void write_metrics_json(std::ostream& os, const TickMetrics& metrics, const std::vector<TickSample>& samples);
+// JSON for a .json extension, CSV otherwise.  Throws std::runtime_error
+// when the file cannot be written.
+void save_metrics(const std::string& path, const TickMetrics& metrics, const std::vector<TickSample>& samples);
+
+} // namespace gol
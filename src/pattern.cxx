@@ -0,0 +1,645 @@
+#include "pattern.h"
+#include "golife.h"
+#include "hashlife.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace gol {
+
+namespace {
+
+[[noreturn]] void parse_error(const std::string& what)
+{
+    throw std::runtime_error("pattern: " + what);
+}
+
+bool starts_with(const char* p, const char* end, const char* prefix) noexcept
+{
+    const std::size_t n = std::strlen(prefix);
+    return static_cast<std::size_t>(end - p) >= n && std::memcmp(p, prefix, n) == 0;
+}
+
+// End of the line starting at p, not counting the newline or a '\r'
+// before it.
+const char* line_end(const char* p, const char* end, const char** next) noexcept
+{
+    const void* nl = std::memchr(p, '\n', static_cast<std::size_t>(end - p));
+    const char* e = nl ? static_cast<const char*>(nl) : end;
+    *next = nl ? e + 1 : end;
+    if (e > p && e[-1] == '\r') {
+        --e;
+    }
+    return e;
+}
+
+const char* skip_blanks(const char* p, const char* end) noexcept
+{
+    while (p < end && (*p == ' ' || *p == '\t')) {
+        ++p;
+    }
+    return p;
+}
+
+const char* parse_int(const char* p, const char* end, std::int64_t& value)
+{
+    auto [ptr, ec] = std::from_chars(p, end, value);
+    if (ec != std::errc{}) {
+        parse_error("expected a number");
+    }
+    return ptr;
+}
+
+template <class F>
+PatternHeader parse_plaintext(const char* p, const char* end, F& emit)
+{
+    PatternHeader h;
+    h.width = 0;
+    std::int64_t y = 0;
+    while (p < end) {
+        const char* next;
+        const char* e = line_end(p, end, &next);
+        if (p < e && *p == '!') {
+            p = next;
+            continue;
+        }
+        for (const char* q = p; q < e;) {
+            if (*q != 'O' && *q != '*') {
+                ++q;
+                continue;
+            }
+            const char* r = q;
+            while (r < e && (*r == 'O' || *r == '*')) {
+                ++r;
+            }
+            emit(q - p, y, r - q);
+            q = r;
+        }
+        h.width = std::max(h.width, static_cast<std::int64_t>(e - p));
+        ++y;
+        p = next;
+    }
+    h.height = y;
+    return h;
+}
+
+// Skip leading comments and read the "x = .., y = .., rule = .." line if
+// there is one.  Returns the start of the body.
+const char* parse_rle_header(const char* p, const char* end, PatternHeader& h)
+{
+    while (p < end) {
+        const char* next;
+        const char* e = line_end(p, end, &next);
+        const char* q = skip_blanks(p, e);
+        if (q == e || *q == '#') {
+            p = next;
+            continue;
+        }
+        if (*q != 'x') {
+            return p;
+        }
+        while (q < e) {
+            const char* key = skip_blanks(q, e);
+            q = key;
+            while (q < e && std::isalpha(static_cast<unsigned char>(*q))) {
+                ++q;
+            }
+            const std::string name(key, q);
+            q = skip_blanks(q, e);
+            if (q == e || *q != '=') {
+                parse_error("malformed RLE header");
+            }
+            q = skip_blanks(q + 1, e);
+            const char* value = q;
+            while (q < e && *q != ',') {
+                ++q;
+            }
+            const char* value_end = q;
+            while (value_end > value && (value_end[-1] == ' ' || value_end[-1] == '\t')) {
+                --value_end;
+            }
+            if (name == "x") {
+                parse_int(value, value_end, h.width);
+            } else if (name == "y") {
+                parse_int(value, value_end, h.height);
+            } else if (name == "rule") {
+                h.rule.assign(value, value_end);
+            }
+            if (q < e) {
+                ++q;
+            }
+        }
+        return next;
+    }
+    return p;
+}
+
+template <class F>
+PatternHeader parse_rle(const char* p, const char* end, F& emit)
+{
+    PatternHeader h;
+    p = parse_rle_header(p, end, h);
+    std::int64_t x = 0;
+    std::int64_t y = 0;
+    std::int64_t count = 0;
+    for (; p < end; ++p) {
+        const char c = *p;
+        if ('0' <= c && c <= '9') {
+            if (count > (std::numeric_limits<std::int64_t>::max() - 9) / 10) {
+                parse_error("RLE run count out of range");
+            }
+            count = count*10 + (c - '0');
+            continue;
+        }
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            continue;
+        }
+        const std::int64_t n = count == 0 ? 1 : count;
+        count = 0;
+        if (c == 'b' || c == '.') {
+            x += n;
+        } else if (c == 'o' || ('A' <= c && c <= 'X')) {
+            emit(x, y, n);
+            x += n;
+        } else if (c == '$') {
+            y += n;
+            x = 0;
+        } else if (c == '!') {
+            break;
+        } else if (c == '#') {
+            const char* next;
+            line_end(p, end, &next);
+            p = next - 1;
+        } else {
+            parse_error(std::string("unexpected '") + c + "' in RLE body");
+        }
+    }
+    return h;
+}
+
+template <class F>
+PatternHeader parse_life106(const char* p, const char* end, F& emit)
+{
+    if (starts_with(p, end, "#Life 1.05")) {
+        parse_error("Life 1.05 patterns are not supported");
+    }
+    // Cells listed left to right along a row are merged into one run.
+    std::int64_t rx = 0;
+    std::int64_t ry = 0;
+    std::int64_t rn = 0;
+    while (p < end) {
+        const char* next;
+        const char* e = line_end(p, end, &next);
+        const char* q = skip_blanks(p, e);
+        p = next;
+        if (q == e || *q == '#') {
+            continue;
+        }
+        std::int64_t x;
+        std::int64_t y;
+        q = parse_int(q, e, x);
+        q = parse_int(skip_blanks(q, e), e, y);
+        if (skip_blanks(q, e) != e) {
+            parse_error("trailing characters on a Life 1.06 line");
+        }
+        if (rn != 0 && y == ry && x == rx + rn) {
+            ++rn;
+            continue;
+        }
+        if (rn != 0) {
+            emit(rx, ry, rn);
+        }
+        rx = x;
+        ry = y;
+        rn = 1;
+    }
+    if (rn != 0) {
+        emit(rx, ry, rn);
+    }
+    return PatternHeader{};
+}
+
+template <class F>
+void emit_macrocell(const Macrocell& mc, std::uint32_t id, std::int64_t x0, std::int64_t y0, F& emit)
+{
+    if (id == 0) {
+        return;
+    }
+    const Macrocell::Node& nd = mc.nodes[id];
+    if (nd.level == 3) {
+        for (int y = 0; y < 8; ++y) {
+            unsigned row = static_cast<unsigned>(nd.leaf >> (8*y)) & 0xffu;
+            while (row != 0) {
+                const int x = __builtin_ctz(row);
+                const int n = __builtin_ctz(~(row >> x));
+                emit(x0 + x, y0 + y, n);
+                row &= ~(((1u << n) - 1) << x);
+            }
+        }
+        return;
+    }
+    const std::int64_t half = std::int64_t{1} << (nd.level - 1);
+    emit_macrocell(mc, nd.nw, x0, y0, emit);
+    emit_macrocell(mc, nd.ne, x0 + half, y0, emit);
+    emit_macrocell(mc, nd.sw, x0, y0 + half, emit);
+    emit_macrocell(mc, nd.se, x0 + half, y0 + half, emit);
+}
+
+// Plaintext, RLE and Life 1.06 are parsed straight from the text; a
+// macrocell's nodes can be shared, so it is read into a Macrocell first.
+template <class F>
+PatternHeader parse(PatternFormat format, const char* p, const char* end, F& emit)
+{
+    switch (format) {
+    case PatternFormat::RLE:
+        return parse_rle(p, end, emit);
+    case PatternFormat::Life106:
+        return parse_life106(p, end, emit);
+    case PatternFormat::Macrocell: {
+        const Macrocell mc = read_macrocell(p, static_cast<std::size_t>(end - p));
+        emit_macrocell(mc, mc.root, 0, 0, emit);
+        PatternHeader h;
+        h.rule = mc.rule;
+        return h;
+    }
+    case PatternFormat::Plaintext:
+        break;
+    }
+    return parse_plaintext(p, end, emit);
+}
+
+// Collects RLE tokens into lines of at most 70 characters.
+class RleWriter
+{
+public:
+    explicit RleWriter(std::ostream& out) : os{out} {}
+
+    void put(std::int64_t n, char tag)
+    {
+        if (n <= 0) {
+            return;
+        }
+        char token[24];
+        char* e = token;
+        if (n > 1) {
+            e = std::to_chars(token, token + sizeof(token) - 1, n).ptr;
+        }
+        *e++ = tag;
+        const std::size_t len = static_cast<std::size_t>(e - token);
+        if (used + len > 70) {
+            newline();
+        }
+        std::memcpy(line + used, token, len);
+        used += len;
+    }
+
+    void newline()
+    {
+        line[used++] = '\n';
+        os.write(line, static_cast<std::streamsize>(used));
+        used = 0;
+    }
+
+private:
+    std::ostream& os;
+    char line[80];
+    std::size_t used = 0;
+};
+
+} // namespace
+
+PatternFormat pattern_format(const std::string& path, const char* data, std::size_t size) noexcept
+{
+    const std::size_t slash = path.find_last_of('/');
+    const std::size_t dot = path.find_last_of('.');
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) {
+        std::string ext = path.substr(dot + 1);
+        for (char& c : ext) {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        if (ext == "rle") {
+            return PatternFormat::RLE;
+        }
+        if (ext == "lif" || ext == "life") {
+            return PatternFormat::Life106;
+        }
+        if (ext == "mc") {
+            return PatternFormat::Macrocell;
+        }
+        if (ext == "cells") {
+            return PatternFormat::Plaintext;
+        }
+    }
+    const char* p = data;
+    const char* end = data + size;
+    if (starts_with(p, end, "[M2]")) {
+        return PatternFormat::Macrocell;
+    }
+    if (starts_with(p, end, "#Life 1.06")) {
+        return PatternFormat::Life106;
+    }
+    while (p < end && *p == '#') {
+        const char* next;
+        line_end(p, end, &next);
+        p = next;
+    }
+    if (p < end && *p == 'x') {
+        return PatternFormat::RLE;
+    }
+    return PatternFormat::Plaintext;
+}
+
+PatternHeader read_pattern(PatternFormat format, const char* data, std::size_t size, RunFn fn, void* ctx)
+{
+    auto emit = [&](std::int64_t x, std::int64_t y, std::int64_t n) { fn(ctx, x, y, n); };
+    return parse(format, data, data + size, emit);
+}
+
+void write_plaintext(std::ostream& os, const Board& b)
+{
+    std::string row(static_cast<std::size_t>(b.ncols), '.');
+    for (int y = 0; y < b.nrows; ++y) {
+        for (int x = 0; x < b.ncols; ++x) {
+            row[static_cast<std::size_t>(x)] = b.live(x, y) ? 'O' : '.';
+        }
+        os << row << '\n';
+    }
+}
+
+void write_rle(std::ostream& os, const Board& b, const std::string& rule)
+{
+    os << "x = " << b.ncols << ", y = " << b.nrows << ", rule = " << rule << '\n';
+    RleWriter w(os);
+    std::int64_t rows = 0; // row ends owed before the next run
+    for (int y = 0; y < b.nrows; ++y) {
+        const int* row = b.brd.data() + static_cast<std::size_t>(y)*static_cast<std::size_t>(b.ncols);
+        const int* row_end = row + b.ncols;
+        const int* p = row;
+        for (;;) {
+            const int* first = std::find(p, row_end, Board::LIVE);
+            if (first == row_end) {
+                break;
+            }
+            const int* last = std::find(first, row_end, Board::DEAD);
+            w.put(rows, '$');
+            rows = 0;
+            w.put(first - p, 'b');
+            w.put(last - first, 'o');
+            p = last;
+        }
+        ++rows;
+    }
+    w.put(1, '!');
+    w.newline();
+}
+
+void write_life106(std::ostream& os, const Board& b)
+{
+    os << "#Life 1.06\n";
+    char buf[4096];
+    std::size_t used = 0;
+    for (int y = 0; y < b.nrows; ++y) {
+        const int* row = b.brd.data() + static_cast<std::size_t>(y)*static_cast<std::size_t>(b.ncols);
+        for (const int* p = row; (p = std::find(p, row + b.ncols, Board::LIVE)) != row + b.ncols; ++p) {
+            char item[48];
+            char* e = std::to_chars(item, item + 20, p - row).ptr;
+            *e++ = ' ';
+            e = std::to_chars(e, item + 44, y).ptr;
+            *e++ = '\n';
+            const std::size_t len = static_cast<std::size_t>(e - item);
+            if (used + len > sizeof(buf)) {
+                os.write(buf, static_cast<std::streamsize>(used));
+                used = 0;
+            }
+            std::memcpy(buf + used, item, len);
+            used += len;
+        }
+    }
+    os.write(buf, static_cast<std::streamsize>(used));
+}
+
+// Node lines are "level nw ne sw se" with children numbered by line; leaf
+// lines are 8x8 pictures in '.', '*' and '$'.
+Macrocell read_macrocell(const char* data, std::size_t size)
+{
+    const char* p = data;
+    const char* end = data + size;
+    if (!starts_with(p, end, "[M2]")) {
+        parse_error("macrocell file does not start with [M2]");
+    }
+    Macrocell mc;
+    mc.nodes.push_back(Macrocell::Node{0, 0, 0, 0, 0, 0});
+    const char* next;
+    line_end(p, end, &next);
+    for (p = next; p < end; p = next) {
+        const char* e = line_end(p, end, &next);
+        if (p == e) {
+            continue;
+        }
+        if (*p == '#') {
+            if (starts_with(p, e, "#R")) {
+                mc.rule.assign(skip_blanks(p + 2, e), e);
+            }
+            continue;
+        }
+        Macrocell::Node nd{3, 0, 0, 0, 0, 0};
+        if (*p == '.' || *p == '*' || *p == '$') {
+            int x = 0;
+            int y = 0;
+            for (const char* q = p; q < e; ++q) {
+                if (*q == '$') {
+                    ++y;
+                    x = 0;
+                    continue;
+                }
+                if ((*q != '.' && *q != '*') || x >= 8 || y >= 8) {
+                    parse_error("malformed macrocell leaf");
+                }
+                if (*q == '*') {
+                    nd.leaf |= std::uint64_t{1} << (8*y + x);
+                }
+                ++x;
+            }
+        } else {
+            std::int64_t v[5];
+            const char* q = p;
+            for (auto& value : v) {
+                q = parse_int(skip_blanks(q, e), e, value);
+            }
+            if (v[0] < 4 || v[0] > 62) {
+                parse_error("macrocell node level out of range");
+            }
+            nd.level = static_cast<int>(v[0]);
+            std::uint32_t* child[4] = {&nd.nw, &nd.ne, &nd.sw, &nd.se};
+            for (int i = 0; i < 4; ++i) {
+                const std::int64_t c = v[i + 1];
+                if (c < 0 || static_cast<std::size_t>(c) >= mc.nodes.size()
+                        || (c != 0 && mc.nodes[static_cast<std::size_t>(c)].level != nd.level - 1)) {
+                    parse_error("bad macrocell child reference");
+                }
+                *child[i] = static_cast<std::uint32_t>(c);
+            }
+        }
+        mc.nodes.push_back(nd);
+    }
+    mc.root = static_cast<std::uint32_t>(mc.nodes.size() - 1);
+    return mc;
+}
+
+void write_macrocell(std::ostream& os, const Macrocell& mc)
+{
+    os << "[M2] (game-of-life)\n";
+    if (!mc.rule.empty()) {
+        os << "#R " << mc.rule << '\n';
+    }
+    std::string line;
+    for (std::size_t i = 1; i < mc.nodes.size(); ++i) {
+        const Macrocell::Node& nd = mc.nodes[i];
+        line.clear();
+        if (nd.level == 3) {
+            for (int y = 0; y < 8; ++y) {
+                const unsigned row = static_cast<unsigned>(nd.leaf >> (8*y)) & 0xffu;
+                for (int x = 0; (row >> x) != 0; ++x) {
+                    line += (row >> x) & 1 ? '*' : '.';
+                }
+                line += '$';
+            }
+            // trailing empty rows can go, but keep one '$' so the line is a leaf
+            while (line.size() > 1 && line[line.size() - 1] == '$' && line[line.size() - 2] == '$') {
+                line.pop_back();
+            }
+        } else {
+            line = std::to_string(nd.level) + ' ' + std::to_string(nd.nw) + ' ' + std::to_string(nd.ne)
+                 + ' ' + std::to_string(nd.sw) + ' ' + std::to_string(nd.se);
+        }
+        line += '\n';
+        os.write(line.data(), static_cast<std::streamsize>(line.size()));
+    }
+}
+
+Board load_pattern(const std::string& path, Rule* rule)
+{
+    const MappedFile file(path);
+    const char* begin = file.begin();
+    const char* end = file.end();
+    const PatternFormat format = pattern_format(path, file.data(), file.size());
+
+    Macrocell mc;
+    if (format == PatternFormat::Macrocell) {
+        mc = read_macrocell(file.data(), file.size());
+    }
+    auto each_run = [&](auto& emit) {
+        if (format == PatternFormat::Macrocell) {
+            emit_macrocell(mc, mc.root, 0, 0, emit);
+            PatternHeader mh;
+            mh.rule = mc.rule;
+            return mh;
+        }
+        return parse(format, begin, end, emit);
+    };
+
+    // RLE declares its size up front; everything else takes a first pass
+    // to find it.  Life 1.06 and macrocell are cropped to the live cells.
+    PatternHeader h;
+    std::int64_t x0 = 0;
+    std::int64_t y0 = 0;
+    if (format == PatternFormat::RLE) {
+        parse_rle_header(begin, end, h);
+    }
+    if (h.width < 0 || h.height < 0) {
+        std::int64_t x1 = std::numeric_limits<std::int64_t>::min();
+        std::int64_t y1 = x1;
+        x0 = std::numeric_limits<std::int64_t>::max();
+        y0 = x0;
+        auto extent = [&](std::int64_t x, std::int64_t y, std::int64_t n) {
+            x0 = std::min(x0, x);
+            y0 = std::min(y0, y);
+            x1 = std::max(x1, x + n);
+            y1 = std::max(y1, y + 1);
+        };
+        h = each_run(extent);
+        if (format == PatternFormat::Plaintext) {
+            x0 = 0;
+            y0 = 0;
+        } else if (x1 < x0) {
+            x0 = 0;
+            y0 = 0;
+            h.width = 0;
+            h.height = 0;
+        } else {
+            h.width = x1 - x0;
+            h.height = y1 - y0;
+        }
+    }
+    if (h.width > INT_MAX || h.height > INT_MAX
+            || static_cast<std::uint64_t>(h.width) * static_cast<std::uint64_t>(h.height) > std::size_t{INT_MAX}) {
+        parse_error(path + " is too large for a Board");
+    }
+
+    Board b(static_cast<int>(h.height), static_cast<int>(h.width));
+    auto fill = [&](std::int64_t x, std::int64_t y, std::int64_t n) {
+        x -= x0;
+        y -= y0;
+        if (x < 0 || y < 0 || y >= h.height || n > h.width - x) {
+            parse_error(path + " has cells outside its declared size");
+        }
+        std::fill_n(b.brd.begin() + y*h.width + x, n, Board::LIVE);
+    };
+    each_run(fill);
+    if (rule && !h.rule.empty() && !parse_rule(h.rule, rule)) {
+        parse_error(path + " has an unsupported rule: " + h.rule);
+    }
+    return b;
+}
+
+void save_pattern(const std::string& path, const Board& b, Rule rule)
+{
+    std::ofstream os(path, std::ios::binary);
+    if (!os) {
+        throw std::runtime_error("cannot open output file: " + path);
+    }
+    switch (pattern_format(path)) {
+    case PatternFormat::Plaintext:
+        write_plaintext(os, b);
+        break;
+    case PatternFormat::RLE:
+        write_rle(os, b, rule_string(rule));
+        break;
+    case PatternFormat::Life106:
+        write_life106(os, b);
+        break;
+    case PatternFormat::Macrocell: {
+        Macrocell mc = HashLife(b).to_macrocell();
+        mc.rule = rule_string(rule);
+        write_macrocell(os, mc);
+        break;
+    }
+    }
+    if (!os.flush()) {
+        throw std::runtime_error("error writing " + path);
+    }
+}
+
+void place(Board& dst, const Board& pattern, int x0, int y0) noexcept
+{
+    for (int y = 0; y < pattern.nrows; ++y) {
+        for (int x = 0; x < pattern.ncols; ++x) {
+            const int dx = x0 + x;
+            const int dy = y0 + y;
+            if (pattern.live(x, y) && 0 <= dx && dx < dst.ncols && 0 <= dy && dy < dst.nrows) {
+                dst.set_live(dx, dy);
+            }
+        }
+    }
+}
+
+} // namespace gol
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "rule.h"
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace gol {
+
+struct Board;
+
+enum class PatternFormat
+{
+    Plaintext, // .cells
+    RLE,       // .rle
+    Life106,   // .lif, .life
+    Macrocell, // .mc
+};
+
+// Pick the format from the file extension; for an unknown extension look
+// at the first bytes of `data` instead, and default to plaintext.
+PatternFormat pattern_format(const std::string& path, const char* data = nullptr, std::size_t size = 0) noexcept;
+
+// What a format says about the pattern besides its cells.  width and height
+// are -1 when the format does not record them (Life 1.06, macrocell).
+struct PatternHeader
+{
+    std::int64_t width = -1;
+    std::int64_t height = -1;
+    std::string rule;
+};
+
+// Receives the live cells of a pattern as horizontal runs of n cells
+// starting at (x, y).
+using RunFn = void (*)(void* ctx, std::int64_t x, std::int64_t y, std::int64_t n);
+
+PatternHeader read_pattern(PatternFormat format, const char* data, std::size_t size, RunFn fn, void* ctx);
+
+// Parse `data` in one pass without copying it, calling fn(x, y, n) for
+// every run of live cells.  Runs arrive in file order, which is row order
+// for plaintext and RLE but not for macrocell.  Malformed input throws
+// std::runtime_error.
+template <class F>
+PatternHeader read_pattern(PatternFormat format, const char* data, std::size_t size, F&& fn)
+{
+    using Fn = std::remove_reference_t<F>;
+    auto thunk = [](void* ctx, std::int64_t x, std::int64_t y, std::int64_t n) { (*static_cast<Fn*>(ctx))(x, y, n); };
+    return read_pattern(format, data, size, thunk, const_cast<void*>(static_cast<const void*>(std::addressof(fn))));
+}
+
+// Plaintext (.cells) patterns, 'O' for a live cell and '.' for a dead one.
+// read_pattern() reads them back.
+void write_plaintext(std::ostream& os, const Board& b);
+
+// Run-length encoded patterns with an "x = .., y = .., rule = .." header,
+// wrapped at 70 columns.
+void write_rle(std::ostream& os, const Board& b, const std::string& rule = "B3/S23");
+
+// Life 1.06: one "x y" pair per live cell.
+void write_life106(std::ostream& os, const Board& b);
+
+// A macrocell file's quadtree as stored, before it is expanded into cells.
+// nodes[i] is the node on line i of the body (numbered from 1); index 0 is
+// the empty node of whatever level its parent needs.  Level-3 nodes are
+// 8x8 leaves with cell (x, y) in bit 8*y + x of `leaf`.
+struct Macrocell
+{
+    struct Node
+    {
+        int level;
+        std::uint32_t nw, ne, sw, se;
+        std::uint64_t leaf;
+    };
+
+    std::vector<Node> nodes;
+    std::uint32_t root = 0;
+    std::string rule;
+};
+
+Macrocell read_macrocell(const char* data, std::size_t size);
+void write_macrocell(std::ostream& os, const Macrocell& mc);
+
+// The file is memory-mapped and parsed in place, and the format is chosen
+// by pattern_format().  Life 1.06 and macrocell patterns are cropped to
+// their live cells.  If `rule` is given and the file names a rule (RLE
+// and macrocell can), it is stored there, and one parse_rule() does not
+// accept is an error.  Throw std::runtime_error if the file cannot be read
+// or does not parse.
+Board load_pattern(const std::string& path, Rule* rule = nullptr);
+// Writes through the stream as it goes; the text is never held in memory.
+// RLE and macrocell files record `rule` in their header.
+void save_pattern(const std::string& path, const Board& b, Rule rule = {});
+
+// Copy `pattern` into `dst` with its top-left corner at (x0, y0); cells
+// that fall outside `dst` are dropped.
+void place(Board& dst, const Board& pattern, int x0, int y0) noexcept;
+
+} // namespace gol
@@ -0,0 +1,113 @@
+#include "rule.h"
+#include <cctype>
+
+namespace gol {
+
+namespace {
+
+struct NamedRule
+{
+    const char* name;
+    Rule rule;
+};
+
+constexpr NamedRule NAMED_RULES[] = {
+    {"conway", CONWAY},
+    {"life", CONWAY},
+    {"highlife", HIGHLIFE},
+    {"daynight", DAY_AND_NIGHT},
+    {"seeds", SEEDS},
+    {"lwod", LIFE_WITHOUT_DEATH},
+    {"maze", MAZE},
+};
+
+// Digits up to the next '/' or the end, as a neighbour-count mask.
+bool parse_counts(const std::string& s, std::size_t& i, std::uint16_t& mask) noexcept
+{
+    mask = 0;
+    for (; i < s.size() && s[i] != '/'; ++i) {
+        if (s[i] < '0' || s[i] > '8') {
+            return false;
+        }
+        mask |= static_cast<std::uint16_t>(1u << (s[i] - '0'));
+    }
+    return true;
+}
+
+} // namespace
+
+bool parse_rule(const std::string& text, Rule* rule) noexcept
+{
+    std::string s;
+    for (char c : text) {
+        if (c != ' ') {
+            s += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+    }
+    for (auto&& named : NAMED_RULES) {
+        if (s == named.name) {
+            *rule = named.rule;
+            return true;
+        }
+    }
+
+    const std::size_t slash = s.find('/');
+    if (slash == std::string::npos || s.find('/', slash + 1) != std::string::npos) {
+        return false;
+    }
+    Rule r;
+    std::size_t i = 0;
+    if (s[0] == 'b' || s[0] == 's') {
+        // B.../S... in either order
+        bool seen_b = false;
+        bool seen_s = false;
+        for (int part = 0; part < 2; ++part) {
+            const char tag = i < s.size() ? s[i] : '\0';
+            ++i;
+            if (tag == 'b' && !seen_b) {
+                seen_b = true;
+                if (!parse_counts(s, i, r.birth)) {
+                    return false;
+                }
+            } else if (tag == 's' && !seen_s) {
+                seen_s = true;
+                if (!parse_counts(s, i, r.survive)) {
+                    return false;
+                }
+            } else {
+                return false;
+            }
+            ++i; // the '/'
+        }
+    } else {
+        // survival/birth
+        if (!parse_counts(s, i, r.survive)) {
+            return false;
+        }
+        ++i;
+        if (!parse_counts(s, i, r.birth)) {
+            return false;
+        }
+    }
+    *rule = r;
+    return true;
+}
+
+std::string rule_string(Rule rule)
+{
+    std::string s = "B";
+    for (int n = 0; n <= 8; ++n) {
+        if (rule.birth >> n & 1) {
+            s += static_cast<char>('0' + n);
+        }
+    }
+    s += "/S";
+    for (int n = 0; n <= 8; ++n) {
+        if (rule.survive >> n & 1) {
+            s += static_cast<char>('0' + n);
+        }
+    }
+    return s;
+}
+
+} // namespace gol
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace gol {
+
+// Outer-totalistic ("Life-like") rule in B/S notation.  A dead cell with n
+// live neighbours is born if bit n of `birth` is set; a live cell with n
+// live neighbours survives if bit n of `survive` is set.  The default is
+// Conway's B3/S23.
+struct Rule
+{
+    std::uint16_t birth = 1u << 3;
+    std::uint16_t survive = 1u << 2 | 1u << 3;
+
+    friend constexpr bool operator==(Rule lhs, Rule rhs) noexcept
+    {
+        return lhs.birth == rhs.birth && lhs.survive == rhs.survive;
+    }
+    friend constexpr bool operator!=(Rule lhs, Rule rhs) noexcept { return !(lhs == rhs); }
+};
+
+constexpr Rule CONWAY             {0x008, 0x00c}; // B3/S23
+constexpr Rule HIGHLIFE           {0x048, 0x00c}; // B36/S23
+constexpr Rule DAY_AND_NIGHT      {0x1c8, 0x1d8}; // B3678/S34678
+constexpr Rule SEEDS              {0x004, 0x000}; // B2/S
+constexpr Rule LIFE_WITHOUT_DEATH {0x008, 0x1ff}; // B3/S012345678
+constexpr Rule MAZE               {0x008, 0x03e}; // B3/S12345
+
+// "B3/S23", "b36/s23", "S23/B3" and the older "23/3" (survival first) are
+// all accepted, as are the names of the rules above ("conway",
+// "highlife", "daynight", "seeds", "lwod", "maze").
+bool parse_rule(const std::string& text, Rule* rule) noexcept;
+std::string rule_string(Rule rule);
+
+// A rule fixed at compile time.  Kernels instantiated for one of these see
+// the masks as constants; see with_fixed_rule().
+template <std::uint16_t Birth, std::uint16_t Survive>
+struct FixedRule
+{
+    static constexpr std::uint16_t birth = Birth;
+    static constexpr std::uint16_t survive = Survive;
+    static constexpr Rule value{Birth, Survive};
+};
+
+using ConwayRule = FixedRule<CONWAY.birth, CONWAY.survive>;
+
+// If `rule` is one of the rules above, call fn(FixedRule<...>{}) for it and
+// return true.  Kernels use this to run a specialization for the common
+// rules and fall back to a table-driven version for anything else.
+template <class F>
+bool with_fixed_rule(Rule rule, F&& fn)
+{
+    auto attempt = [&](auto fixed) {
+        if (rule != decltype(fixed)::value) {
+            return false;
+        }
+        fn(fixed);
+        return true;
+    };
+    return attempt(ConwayRule{})
+        || attempt(FixedRule<HIGHLIFE.birth, HIGHLIFE.survive>{})
+        || attempt(FixedRule<DAY_AND_NIGHT.birth, DAY_AND_NIGHT.survive>{})
+        || attempt(FixedRule<SEEDS.birth, SEEDS.survive>{})
+        || attempt(FixedRule<LIFE_WITHOUT_DEATH.birth, LIFE_WITHOUT_DEATH.survive>{})
+        || attempt(FixedRule<MAZE.birth, MAZE.survive>{});
+}
+
+} // namespace gol
@@ -0,0 +1,189 @@
+#include "simulation.h"
+#include "bitboard.h"
+#include "checkpoint.h"
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace gol {
+
+Simulation::~Simulation()
+{
+    stop();
+}
+
+void Simulation::reset(const Board& b, Rule rule)
+{
+    assert(!running());
+    const auto ncells = static_cast<std::size_t>(b.nrows) * static_cast<std::size_t>(b.ncols);
+    if (zobrist.size() != ncells) {
+        zobrist = Zobrist(ncells);
+    }
+    hist.reset(b, rule);
+    hash = zobrist.hash(b);
+    cycles.reset();
+    cycles.observe(hash, [](std::size_t) { return false; });
+    cycle.reset();
+    population = std::count(b.brd.begin(), b.brd.end(), Board::LIVE);
+    metrics.reset();
+    publish();
+}
+
+void Simulation::save_checkpoint(const std::string& path) const
+{
+    assert(!running());
+    gol::save_checkpoint(path, BitBoard(hist.latest()).view(), hist.generation(), hist.rule(), Topology::Bounded, &hist,
+                         &cycles.recorded());
+}
+
+// The cycle detector takes the saved hashes as they are; Zobrist keys
+// depend only on the board size, so they still match.  Only the latest
+// generation is checked against the earlier ones, as step() would have.
+void Simulation::restore(const Checkpoint& c)
+{
+    assert(!running());
+    if (c.topology() != Topology::Bounded) {
+        throw std::runtime_error(std::string("checkpoint: saved on a ") + topology_name(c.topology())
+                + " board, but the simulation only runs bounded ones");
+    }
+    if (!c.has_history()) {
+        reset(c.cells().to_board(), c.rule());
+        return;
+    }
+    History restored = c.history();
+    std::vector<std::uint64_t> hashes = c.hashes();
+    if (hashes.size() != restored.size()) {
+        throw std::runtime_error("checkpoint: history saved without its hashes");
+    }
+    hist = std::move(restored);
+    const Board& b = hist.latest();
+    const auto ncells = static_cast<std::size_t>(b.nrows) * static_cast<std::size_t>(b.ncols);
+    if (zobrist.size() != ncells) {
+        zobrist = Zobrist(ncells);
+    }
+    hash = hashes.back();
+    hashes.pop_back();
+    cycles.assign(std::move(hashes));
+    cycle = cycles.observe(hash, [&](std::size_t g) { return hist.at(g) == b; });
+    population = std::count(b.brd.begin(), b.brd.end(), Board::LIVE);
+    metrics.reset();
+    publish();
+}
+
+void Simulation::advance()
+{
+    assert(!running());
+    step();
+    publish();
+}
+
+void Simulation::rewind()
+{
+    assert(!running());
+    hist.pop();
+    cycles.truncate(hist.size());
+    hash = cycles.last_hash();
+    cycle.reset();
+    const Board& b = hist.latest();
+    population = std::count(b.brd.begin(), b.brd.end(), Board::LIVE);
+    publish();
+}
+
+void Simulation::start(std::chrono::nanoseconds period)
+{
+    stop();
+    set_period(period);
+    stopping.store(false, std::memory_order_relaxed);
+    active.store(true, std::memory_order_release);
+    worker = std::thread([this] { run(); });
+}
+
+void Simulation::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping.store(true, std::memory_order_relaxed);
+    }
+    wake_cv.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void Simulation::set_period(std::chrono::nanoseconds period) noexcept
+{
+    period_ns.store(period.count(), std::memory_order_relaxed);
+}
+
+// Paced runs publish every generation.  Unpaced ones only publish once the
+// reader has picked up the previous snapshot, so copying boards for the
+// display costs at most one copy per frame rather than one per generation.
+void Simulation::run()
+{
+    using Clock = std::chrono::steady_clock;
+    auto next = Clock::now();
+    for (;;) {
+        step();
+        const bool done = steady();
+        const std::chrono::nanoseconds period(period_ns.load(std::memory_order_relaxed));
+        if (done || period.count() > 0 || snapshots.consumed()) {
+            publish();
+        }
+        if (done) {
+            break;
+        }
+        if (period.count() > 0) {
+            // a late generation delays the next one rather than bunching up
+            next = std::max(next + period, Clock::now());
+            std::unique_lock<std::mutex> lock(mtx);
+            wake_cv.wait_until(lock, next, [this] { return stopping.load(std::memory_order_relaxed); });
+        }
+        if (stopping.load(std::memory_order_relaxed)) {
+            publish();
+            break;
+        }
+    }
+    active.store(false, std::memory_order_release);
+}
+
+// The flips History records anyway give births and deaths for the cost of
+// one lookup per changed cell.
+void Simulation::step()
+{
+    using Clock = std::chrono::steady_clock;
+    const auto begin = Clock::now();
+    hist.advance();
+    hash = zobrist.update(hash, hist.last_flips());
+    cycle = cycles.observe(hash, [this](std::size_t gen) {
+        return hist.at(gen) == hist.latest();
+    });
+    const auto latency = Clock::now() - begin;
+
+    const Board& b = hist.latest();
+    std::int64_t births = 0;
+    for (std::uint32_t i : hist.last_flips()) {
+        births += b.brd[i];
+    }
+    const auto deaths = static_cast<std::int64_t>(hist.last_flips().size()) - births;
+    population += births - deaths;
+    metrics.record({hist.generation(), latency, {population, births, deaths}});
+}
+
+bool Simulation::steady() const noexcept
+{
+    return hist.latest().empty() || cycle.has_value();
+}
+
+void Simulation::publish()
+{
+    Snapshot& s = snapshots.back();
+    s.board = hist.latest();
+    s.generation = hist.size();
+    s.cycle = cycle;
+    s.metrics = metrics;
+    snapshots.publish();
+}
+
+} // namespace gol
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "cycle.h"
+#include "golife.h"
+#include "history.h"
+#include "metrics.h"
+#include "triple_buffer.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+namespace gol {
+
+class Checkpoint;
+
+// A board's history and cycle detection, advanced either in place or on a
+// background thread.  Finished generations reach the reader through a
+// TripleBuffer, so a render loop can show the most recent one without
+// ever blocking the simulation, and the simulation never waits for the
+// render loop.
+class Simulation
+{
+public:
+    struct Snapshot
+    {
+        Board board;
+        std::size_t generation = 0;
+        std::optional<Cycle> cycle;
+        // Every generation stepped since the last reset(), as of `generation`.
+        TickMetrics metrics;
+    };
+
+    Simulation() = default;
+    ~Simulation();
+    Simulation(const Simulation&) = delete;
+    Simulation& operator=(const Simulation&) = delete;
+
+    // Only while stopped.
+    void reset(const Board& b, Rule rule = {});
+    void advance();
+    void rewind();
+    const History& history() const noexcept { return hist; }
+    Rule rule() const noexcept { return hist.rule(); }
+    // A checkpoint of the latest generation and the whole history.
+    void save_checkpoint(const std::string& path) const;
+    // Continue from a checkpoint's history, or start over from its board
+    // if it was saved without one, under the checkpoint's rule.  Throws
+    // std::runtime_error for a wrapped topology, which only the halo
+    // engine runs, or if the history came without the hashes of its
+    // generations.
+    void restore(const Checkpoint& c);
+
+    // Step on a background thread, one generation per `period`, or as fast
+    // as possible for a zero period, until stop() is called or the board
+    // dies out or starts repeating.
+    void start(std::chrono::nanoseconds period);
+    // Wait for the thread to finish its current generation and exit.
+    void stop();
+    bool running() const noexcept { return active.load(std::memory_order_acquire); }
+    void set_period(std::chrono::nanoseconds period) noexcept;
+
+    // The latest published generation, for a single reader thread.  The
+    // reference stays valid until the next call.
+    const Snapshot& snapshot() noexcept
+    {
+        snapshots.update();
+        return snapshots.front();
+    }
+
+private:
+    void run();
+    void step();
+    bool steady() const noexcept;
+    void publish();
+
+    History hist;
+    Zobrist zobrist;
+    CycleDetector cycles;
+    std::uint64_t hash = 0;
+    std::optional<Cycle> cycle;
+    std::int64_t population = 0;
+    TickMetrics metrics;
+    TripleBuffer<Snapshot> snapshots;
+
+    std::thread worker;
+    std::atomic<bool> active{false};
+    std::atomic<std::int64_t> period_ns{0};
+    std::atomic<bool> stopping{false};
+    std::mutex mtx; // only for waking a paced sleep early
+    std::condition_variable wake_cv;
+};
+
+} // namespace gol
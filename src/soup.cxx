@@ -0,0 +1,620 @@
+#include "soup.h"
+#include "bitboard.h"
+#include "golife.h"
+#include "kernels.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GOL_X86_SOUPS 1
+#endif
+
+namespace gol {
+
+namespace {
+
+// Rows of two or four boards side by side, stepped as one GCC vector.
+// Slots are allocated in multiples of LANES so either width divides them.
+// Lanes4 values only ever exist inside Ensemble::advance_avx2(), which
+// inlines everything it calls, so the calling convention for 32-byte
+// vectors that GCC's -Wpsabi warns about never comes into play; the
+// warning is turned off for this file in CMakeLists.txt.
+using Lanes2 = std::uint64_t __attribute__((vector_size(16)));
+using Lanes4 = std::uint64_t __attribute__((vector_size(32)));
+constexpr int LANES = 4;
+
+// Generations of hashes kept per board; cycles of up to HISTORY - 1
+// generations are detected.  Boards are only checked every CHECK_EVERY
+// generations, which costs a few extra generations per soup.
+constexpr int HISTORY = 32;
+constexpr int CHECK_EVERY = 8;
+
+using Rows = std::vector<std::uint64_t>;
+using Cells = std::vector<std::pair<int, int>>;
+
+std::uint64_t splitmix64(std::uint64_t& state) noexcept
+{
+    std::uint64_t z = (state += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+}
+
+std::uint64_t row_mask(int cols) noexcept
+{
+    return cols == 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << cols) - 1;
+}
+
+// Rows [0, config.rows) of soup n, `stride` words apart.
+void soup_rows(const SoupConfig& config, std::uint64_t n, std::uint64_t* rows, std::ptrdiff_t stride) noexcept
+{
+    std::uint64_t key = config.seed;
+    std::uint64_t state = splitmix64(key) ^ (n * 0xd1342543de82ef95);
+    const int size = config.soup_size;
+    const int x0 = (config.cols - size) / 2;
+    const int y0 = (config.rows - size) / 2;
+    const std::uint64_t square = row_mask(size);
+    const std::uint64_t threshold = config.density >= 1 ? ~std::uint64_t{0}
+                                  : static_cast<std::uint64_t>(std::ldexp(std::max(config.density, 0.0), 64));
+    for (int y = 0; y < config.rows; ++y) {
+        std::uint64_t row = 0;
+        if (y0 <= y && y < y0 + size) {
+            if (config.density == 0.5) {
+                row = splitmix64(state) & square;
+            } else {
+                for (int x = 0; x < size; ++x) {
+                    if (splitmix64(state) < threshold) {
+                        row |= std::uint64_t{1} << x;
+                    }
+                }
+            }
+        }
+        rows[y*stride] = row << x0;
+    }
+}
+
+// One generation of a single board, for the occasional work on one slot.
+void step_board(Rule rule, const Rows& in, Rows& out, std::uint64_t mask) noexcept
+{
+    const std::size_t n = in.size();
+    for (std::size_t y = 0; y < n; ++y) {
+        const std::uint64_t u = y > 0 ? in[y - 1] : 0;
+        const std::uint64_t c = in[y];
+        const std::uint64_t d = y + 1 < n ? in[y + 1] : 0;
+        out[y] = bits::step(rule, u << 1, u, u >> 1, c << 1, c, c >> 1, d << 1, d, d >> 1) & mask;
+    }
+}
+
+// The cells as hex rows, in whichever of their eight orientations and
+// (for an oscillator) phases gives the smallest string.
+std::string object_code(const std::vector<Cells>& phases)
+{
+    std::string best;
+    Cells t;
+    for (const Cells& cells : phases) {
+        for (int sym = 0; sym < 8; ++sym) {
+            t.clear();
+            for (auto [x, y] : cells) {
+                x = sym & 1 ? -x : x;
+                y = sym & 2 ? -y : y;
+                t.emplace_back(sym & 4 ? std::make_pair(y, x) : std::make_pair(x, y));
+            }
+            int x0 = t[0].first, y0 = t[0].second, x1 = x0, y1 = y0;
+            for (auto [x, y] : t) {
+                x0 = std::min(x0, x);
+                y0 = std::min(y0, y);
+                x1 = std::max(x1, x);
+                y1 = std::max(y1, y);
+            }
+            const int digits = (x1 - x0) / 4 + 1;
+            const int nrows = y1 - y0 + 1;
+            std::vector<int> nibbles(static_cast<std::size_t>(digits * nrows), 0);
+            for (auto [x, y] : t) {
+                nibbles[static_cast<std::size_t>((y - y0)*digits + (x - x0) / 4)] |= 1 << ((x - x0) % 4);
+            }
+            std::string code;
+            for (int y = 0; y < nrows; ++y) {
+                if (y > 0) {
+                    code += '.';
+                }
+                for (int d = 0; d < digits; ++d) {
+                    code += "0123456789abcdef"[nibbles[static_cast<std::size_t>(y*digits + d)]];
+                }
+            }
+            if (best.empty() || code < best) {
+                best = std::move(code);
+            }
+        }
+    }
+    return best;
+}
+
+const std::map<std::string, std::string>& object_names();
+
+// Split a settled board, given as every phase of its cycle, into objects:
+// groups of cells that touch (diagonally too) in some phase.  Each object
+// is counted under its name or code.
+void count_objects(const std::vector<Rows>& phases, int cols, bool named,
+                   std::map<std::string, std::uint64_t>& census)
+{
+    const int nrows = static_cast<int>(phases[0].size());
+    Rows all(phases[0].size(), 0);
+    for (const Rows& rows : phases) {
+        for (std::size_t y = 0; y < rows.size(); ++y) {
+            all[y] |= rows[y];
+        }
+    }
+    auto lit = [&](int x, int y) { return 0 <= x && x < cols && 0 <= y && y < nrows && (all[static_cast<std::size_t>(y)] >> x) & 1; };
+
+    Cells object, stack;
+    std::vector<Cells> cells(phases.size());
+    for (int y = 0; y < nrows; ++y) {
+        for (int x = 0; x < cols; ++x) {
+            if (!lit(x, y)) {
+                continue;
+            }
+            // flood fill, clearing cells from `all` as they are taken
+            object.clear();
+            stack.assign(1, {x, y});
+            all[static_cast<std::size_t>(y)] &= ~(std::uint64_t{1} << x);
+            while (!stack.empty()) {
+                const auto [cx, cy] = stack.back();
+                stack.pop_back();
+                object.emplace_back(cx, cy);
+                for (int dy = -1; dy <= 1; ++dy) {
+                    for (int dx = -1; dx <= 1; ++dx) {
+                        if (lit(cx + dx, cy + dy)) {
+                            all[static_cast<std::size_t>(cy + dy)] &= ~(std::uint64_t{1} << (cx + dx));
+                            stack.emplace_back(cx + dx, cy + dy);
+                        }
+                    }
+                }
+            }
+
+            for (std::size_t p = 0; p < phases.size(); ++p) {
+                cells[p].clear();
+                for (auto [ox, oy] : object) {
+                    if ((phases[p][static_cast<std::size_t>(oy)] >> ox) & 1) {
+                        cells[p].emplace_back(ox, oy);
+                    }
+                }
+            }
+            // the object may cycle faster than the board as a whole
+            std::size_t period = phases.size();
+            for (std::size_t q = 1; q < period; ++q) {
+                if (period % q == 0 && cells[q] == cells[0]) {
+                    period = q;
+                    break;
+                }
+            }
+            const std::vector<Cells> cycle(cells.begin(), cells.begin() + static_cast<std::ptrdiff_t>(period));
+            std::string key = (period == 1 ? "xs" + std::to_string(cells[0].size()) : "xp" + std::to_string(period))
+                            + "_" + object_code(cycle);
+            if (named) {
+                const auto& names = object_names();
+                const auto it = names.find(key);
+                if (it != names.end()) {
+                    key = it->second;
+                }
+            }
+            ++census[key];
+        }
+    }
+}
+
+struct KnownObject
+{
+    const char* name;
+    const char* cells; // rows separated by '/'
+};
+
+constexpr KnownObject KNOWN_OBJECTS[] = {
+    {"block", "oo/oo"},
+    {"beehive", ".oo/o..o/.oo"},
+    {"loaf", ".oo/o..o/.o.o/..o"},
+    {"boat", "oo/o.o/.o"},
+    {"ship", "oo/o.o/.oo"},
+    {"tub", ".o/o.o/.o"},
+    {"pond", ".oo/o..o/o..o/.oo"},
+    {"long boat", "oo/o.o/.o.o/..o"},
+    {"barge", ".o/o.o/.o.o/..o"},
+    {"mango", ".oo/o..o/.o..o/..oo"},
+    {"eater", "oo/o.o/..o/..oo"},
+    {"aircraft carrier", "oo/o..o/..oo"},
+    {"snake", "oo.o/o.oo"},
+    {"blinker", "ooo"},
+    {"toad", ".ooo/ooo"},
+    {"beacon", "oo/oo/..oo/..oo"},
+    {"pulsar", "..ooo...ooo/"
+               "/"
+               "o....o.o....o/"
+               "o....o.o....o/"
+               "o....o.o....o/"
+               "..ooo...ooo/"
+               "/"
+               "..ooo...ooo/"
+               "o....o.o....o/"
+               "o....o.o....o/"
+               "o....o.o....o/"
+               "/"
+               "..ooo...ooo"},
+    {"pentadecathlon", "..o....o/oo.oooo.oo/..o....o"},
+};
+
+// Codes of the objects above, found by running each one alone.  Only
+// meaningful for B3/S23.
+const std::map<std::string, std::string>& object_names()
+{
+    static const std::map<std::string, std::string> names = [] {
+        constexpr int PAD = 8;
+        std::map<std::string, std::string> result;
+        for (const KnownObject& known : KNOWN_OBJECTS) {
+            const auto height = std::count(known.cells, known.cells + std::strlen(known.cells), '/') + 1;
+            Rows start(static_cast<std::size_t>(height + 2*PAD), 0);
+            std::size_t y = PAD;
+            int x = 0;
+            for (const char* c = known.cells; *c; ++c) {
+                if (*c == '/') {
+                    ++y;
+                    x = 0;
+                } else {
+                    if (*c == 'o') {
+                        start[y] |= std::uint64_t{1} << (PAD + x);
+                    }
+                    ++x;
+                }
+            }
+            std::vector<Rows> phases{start};
+            Rows next(start.size());
+            for (;;) {
+                step_board(CONWAY, phases.back(), next, ~std::uint64_t{0});
+                if (next == start || phases.size() == HISTORY) {
+                    break;
+                }
+                phases.push_back(next);
+            }
+            std::map<std::string, std::uint64_t> codes;
+            count_objects(phases, 64, false, codes);
+            if (codes.size() == 1) {
+                result.emplace(codes.begin()->first, known.name);
+            }
+        }
+        return result;
+    }();
+    return names;
+}
+
+template <class R>
+struct FixedStep
+{
+    template <class V>
+    V operator()(V nw, V n, V ne, V w, V c, V e, V sw, V s, V se) const noexcept
+    {
+        return bits::step<R>(nw, n, ne, w, c, e, sw, s, se);
+    }
+};
+
+struct RuleStep
+{
+    Rule rule;
+
+    template <class V>
+    V operator()(V nw, V n, V ne, V w, V c, V e, V sw, V s, V se) const noexcept
+    {
+        return bits::step(rule, nw, n, ne, w, c, e, sw, s, se);
+    }
+};
+
+// A set of boards that are all advanced by the same pass.  Row y of every
+// slot is stored contiguously, so each pass over a row steps LANES boards
+// per operation.  Whenever a board settles it is counted and the slot is
+// refilled with the next soup.
+class Ensemble
+{
+public:
+    Ensemble(const SoupConfig& cfg, int nslots, SoupStats& out)
+        : config{cfg}
+        , stats{out}
+        , stride{(nslots + LANES - 1) / LANES * LANES}
+        , active{stride}
+        , mask{row_mask(cfg.cols)}
+        , cur(static_cast<std::size_t>((cfg.rows + 2) * stride), 0)
+        , next(cur.size(), 0)
+        , ring(static_cast<std::size_t>(HISTORY * stride), 0)
+        , start(static_cast<std::size_t>(stride), 0)
+        , busy(static_cast<std::size_t>(stride), 0)
+    {
+    }
+
+    // Run soups taken from `soups` until it reaches `end`.
+    void run(std::atomic<std::uint64_t>& soups, std::uint64_t end)
+    {
+        source = &soups;
+        last = end;
+        for (int s = 0; s < stride; ++s) {
+            refill(s);
+        }
+        const bool fixed = with_fixed_rule(config.rule, [&](auto r) {
+            run_with(FixedStep<decltype(r)>{});
+        });
+        if (!fixed) {
+            run_with(RuleStep{config.rule});
+        }
+    }
+
+private:
+    template <class Step>
+    void run_with(Step step)
+    {
+#ifdef GOL_X86_SOUPS
+        const Kernel k = active_kernel();
+        const bool wide = k == Kernel::AVX2 || k == Kernel::AVX512;
+#endif
+        while (nbusy > 0) {
+            for (int i = 0; i < CHECK_EVERY; ++i) {
+#ifdef GOL_X86_SOUPS
+                if (wide) {
+                    advance_avx2(step);
+                    continue;
+                }
+#endif
+                advance<Lanes2>(step);
+            }
+            check();
+        }
+    }
+
+    // One generation of every slot, V (a vector of words) at a time.  The
+    // hash of each new board goes straight into the ring.
+    template <class V, class Step>
+    [[gnu::always_inline]] inline void advance(Step step) noexcept
+    {
+        constexpr int WIDTH = sizeof(V) / sizeof(std::uint64_t);
+        const V m = V{} + mask;
+        std::uint64_t* const hash = ring.data() + ((gen + 1) % HISTORY)*stride;
+        std::fill_n(hash, active, 0);
+        for (int y = 1; y <= config.rows; ++y) {
+            const std::uint64_t* up = cur.data() + (y - 1)*stride;
+            const std::uint64_t* mid = up + stride;
+            const std::uint64_t* down = mid + stride;
+            std::uint64_t* out = next.data() + y*stride;
+            for (int s = 0; s < active; s += WIDTH) {
+                V u, c, d, h;
+                std::memcpy(&u, up + s, sizeof u);
+                std::memcpy(&c, mid + s, sizeof c);
+                std::memcpy(&d, down + s, sizeof d);
+                std::memcpy(&h, hash + s, sizeof h);
+                const V o = step(u << 1, u, u >> 1, c << 1, c, c >> 1, d << 1, d, d >> 1) & m;
+                h = ((h << 7) | (h >> 57)) ^ o;
+                std::memcpy(out + s, &o, sizeof o);
+                std::memcpy(hash + s, &h, sizeof h);
+            }
+        }
+        std::swap(cur, next);
+        ++gen;
+    }
+
+#ifdef GOL_X86_SOUPS
+    // flatten inlines the whole step into this function, so no 32-byte
+    // vector is ever passed between code built for different targets.
+    template <class Step>
+    __attribute__((target("avx2"), flatten))
+    void advance_avx2(Step step) noexcept
+    {
+        advance<Lanes4>(step);
+    }
+#endif
+
+    std::uint64_t hash_slot(int s) const noexcept
+    {
+        std::uint64_t h = 0;
+        for (int y = 1; y <= config.rows; ++y) {
+            h = ((h << 7) | (h >> 57)) ^ cur[static_cast<std::size_t>(y*stride + s)];
+        }
+        return h;
+    }
+
+    // Settle every slot whose hash matches one from 1..HISTORY-1
+    // generations ago, and give up on those that ran too long.
+    void check()
+    {
+        const std::uint64_t* now = ring.data() + (gen % HISTORY)*stride;
+        for (int s = 0; s < active; ++s) {
+            if (!busy[static_cast<std::size_t>(s)]) {
+                continue;
+            }
+            const std::int64_t age = gen - start[static_cast<std::size_t>(s)];
+            const int longest = static_cast<int>(std::min<std::int64_t>(age, HISTORY - 1));
+            bool settled = false;
+            for (int p = 1; p <= longest; ++p) {
+                if (ring[static_cast<std::size_t>(((gen - p) % HISTORY)*stride + s)] == now[s]) {
+                    settled = settle(s, p);
+                    break;
+                }
+            }
+            if (!settled && age >= config.max_generations) {
+                ++stats.soups;
+                ++stats.unsettled;
+                stats.generations += static_cast<std::uint64_t>(age);
+                refill(s);
+            }
+        }
+        if (drained && nbusy <= active / 2) {
+            compact();
+        }
+    }
+
+    // Once the soups have run out, move the boards still running to the
+    // front so passes stop covering the empty slots behind them.
+    void compact() noexcept
+    {
+        int to = 0;
+        for (int from = 0; from < active; ++from) {
+            if (!busy[static_cast<std::size_t>(from)]) {
+                continue;
+            }
+            if (to != from) {
+                for (int y = 1; y <= config.rows; ++y) {
+                    cur[static_cast<std::size_t>(y*stride + to)] = cur[static_cast<std::size_t>(y*stride + from)];
+                }
+                for (int g = 0; g < HISTORY; ++g) {
+                    ring[static_cast<std::size_t>(g*stride + to)] = ring[static_cast<std::size_t>(g*stride + from)];
+                }
+                start[static_cast<std::size_t>(to)] = start[static_cast<std::size_t>(from)];
+                busy[static_cast<std::size_t>(to)] = 1;
+                busy[static_cast<std::size_t>(from)] = 0;
+            }
+            ++to;
+        }
+        active = (to + LANES - 1) / LANES * LANES;
+        for (int y = 1; y <= config.rows; ++y) {
+            std::fill(cur.begin() + y*stride + to, cur.begin() + y*stride + active, 0);
+        }
+    }
+
+    // Confirm the cycle by running it on the side, since the hashes can
+    // collide, then census the board.
+    bool settle(int s, int period)
+    {
+        phases.resize(static_cast<std::size_t>(period));
+        for (Rows& rows : phases) {
+            rows.resize(static_cast<std::size_t>(config.rows));
+        }
+        scratch.resize(static_cast<std::size_t>(config.rows));
+        for (int y = 0; y < config.rows; ++y) {
+            phases[0][static_cast<std::size_t>(y)] = cur[static_cast<std::size_t>((y + 1)*stride + s)];
+        }
+        for (int p = 1; p <= period; ++p) {
+            step_board(config.rule, phases[static_cast<std::size_t>(p - 1)],
+                       p < period ? phases[static_cast<std::size_t>(p)] : scratch, mask);
+        }
+        if (scratch != phases[0]) {
+            return false;
+        }
+
+        ++stats.soups;
+        stats.generations += static_cast<std::uint64_t>(gen - start[static_cast<std::size_t>(s)]);
+        if (std::all_of(scratch.begin(), scratch.end(), [](std::uint64_t row) { return row == 0; })) {
+            ++stats.died;
+        } else {
+            count_objects(phases, config.cols, config.rule == CONWAY, stats.census);
+        }
+        refill(s);
+        return true;
+    }
+
+    void refill(int s)
+    {
+        auto& slot_busy = busy[static_cast<std::size_t>(s)];
+        if (slot_busy) {
+            slot_busy = 0;
+            --nbusy;
+        }
+        std::uint64_t* rows = cur.data() + stride + s;
+        const std::uint64_t n = source->fetch_add(1, std::memory_order_relaxed);
+        if (n >= last) {
+            for (int y = 0; y < config.rows; ++y) {
+                rows[y*stride] = 0;
+            }
+            drained = true;
+            return;
+        }
+        soup_rows(config, n, rows, stride);
+        start[static_cast<std::size_t>(s)] = gen;
+        ring[static_cast<std::size_t>((gen % HISTORY)*stride + s)] = hash_slot(s);
+        slot_busy = 1;
+        ++nbusy;
+    }
+
+    const SoupConfig& config;
+    SoupStats& stats;
+    int stride;
+    int active; // slots the passes cover, from the front
+    std::uint64_t mask;
+    // rows + 2 rows of `stride` words each; the first and last stay empty
+    Rows cur;
+    Rows next;
+    // hashes of the last HISTORY generations, one row of `stride` each
+    Rows ring;
+    std::vector<std::int64_t> start;
+    std::vector<std::uint8_t> busy;
+    int nbusy = 0;
+    bool drained = false;
+    std::int64_t gen = 0;
+    std::atomic<std::uint64_t>* source = nullptr;
+    std::uint64_t last = 0;
+    std::vector<Rows> phases;
+    Rows scratch;
+};
+
+} // namespace
+
+void SoupStats::merge(const SoupStats& other)
+{
+    soups += other.soups;
+    died += other.died;
+    unsettled += other.unsettled;
+    generations += other.generations;
+    for (auto&& [key, n] : other.census) {
+        census[key] += n;
+    }
+}
+
+SoupStats search_soups(const SoupConfig& config, std::uint64_t first, std::uint64_t count, ThreadPool* pool)
+{
+    if (config.rows < 1 || config.cols < 1 || config.cols > 64) {
+        throw std::invalid_argument("soup boards must be 1 to 64 columns wide");
+    }
+    if (config.soup_size < 1 || config.soup_size > std::min(config.rows, config.cols)) {
+        throw std::invalid_argument("the soup must fit on the board");
+    }
+    if (config.slots < 1 || config.max_generations < 1) {
+        throw std::invalid_argument("soup search needs at least one slot and one generation");
+    }
+
+    // Ensembles take soups from a shared counter as their slots free up,
+    // so threads that draw quick soups simply do more of them.
+    std::atomic<std::uint64_t> soups{first};
+    const std::uint64_t end = first + count;
+    const int nthreads = pool ? pool->size() : 1;
+    const int nslots = static_cast<int>(std::min<std::uint64_t>(
+            static_cast<std::uint64_t>(config.slots), count / static_cast<std::uint64_t>(nthreads) + 1));
+    std::vector<SoupStats> parts(static_cast<std::size_t>(nthreads));
+    auto work = [&](int t) {
+        Ensemble(config, nslots, parts[static_cast<std::size_t>(t)]).run(soups, end);
+    };
+    if (pool) {
+        pool->parallel_for(nthreads, work);
+    } else {
+        work(0);
+    }
+
+    SoupStats stats;
+    for (const SoupStats& part : parts) {
+        stats.merge(part);
+    }
+    return stats;
+}
+
+Board soup_board(const SoupConfig& config, std::uint64_t n)
+{
+    Rows rows(static_cast<std::size_t>(config.rows));
+    soup_rows(config, n, rows.data(), 1);
+    Board b(config.rows, config.cols);
+    for (int y = 0; y < config.rows; ++y) {
+        for (int x = 0; x < config.cols; ++x) {
+            if ((rows[static_cast<std::size_t>(y)] >> x) & 1) {
+                b.set_live(x, y);
+            }
+        }
+    }
+    return b;
+}
+
+} // namespace gol
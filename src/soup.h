@@ -0,0 +1,53 @@
+#pragma once
+
+#include "rule.h"
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace gol {
+
+struct Board;
+class ThreadPool;
+
+// Random-soup search: small bounded boards, each seeded with a random
+// square of cells in the middle, run until they die out or settle into a
+// cycle, after which what is left is counted object by object.
+struct SoupConfig
+{
+    int rows = 32;
+    int cols = 32;           // at most 64: each row is one word
+    int soup_size = 16;      // side of the random square
+    double density = 0.5;
+    int slots = 512;         // boards advanced together by one ensemble
+    std::int64_t max_generations = 4000;
+    std::uint64_t seed = 1;
+    Rule rule = {};
+};
+
+struct SoupStats
+{
+    std::uint64_t soups = 0;
+    std::uint64_t died = 0;        // nothing left alive
+    std::uint64_t unsettled = 0;   // still changing after max_generations
+    std::uint64_t generations = 0; // summed over all soups
+    // Objects left by the settled soups.  Common B3/S23 objects go by name
+    // ("block", "blinker", ...); anything else by a code of its smallest
+    // orientation and phase, "xs<population>_<rows>" for still lifes and
+    // "xp<period>_<rows>" for oscillators, each row in hex with bit 0 at
+    // the left.
+    std::map<std::string, std::uint64_t> census;
+
+    void merge(const SoupStats& other);
+};
+
+// Run soups [first, first + count) of config.seed.  Soup n always starts
+// from soup_board(config, n), however the work is split between threads,
+// so a search can be divided up or resumed.  Throws std::invalid_argument
+// for a config it cannot run.
+SoupStats search_soups(const SoupConfig& config, std::uint64_t first, std::uint64_t count,
+                       ThreadPool* pool = nullptr);
+
+Board soup_board(const SoupConfig& config, std::uint64_t n);
+
+} // namespace gol
@@ -0,0 +1,233 @@
+#include "sparse.h"
+#include "bitboard.h"
+#include "golife.h"
+#include <algorithm>
+#include <cassert>
+
+namespace gol {
+
+namespace {
+
+constexpr std::int64_t floor_div(std::int64_t a, std::int64_t b) noexcept
+{
+    return a / b - ((a % b != 0) && ((a < 0) != (b < 0)) ? 1 : 0);
+}
+
+constexpr int floor_mod(std::int64_t a, std::int64_t b) noexcept
+{
+    return static_cast<int>(a - floor_div(a, b)*b);
+}
+
+} // namespace
+
+SparseUniverse::SparseUniverse(const Board& b)
+{
+    for (int y = 0; y < b.nrows; ++y) {
+        for (int x = 0; x < b.ncols; ++x) {
+            if (b.live(x, y)) {
+                set_live(x, y);
+            }
+        }
+    }
+}
+
+std::uint64_t SparseUniverse::key(std::int64_t cx, std::int64_t cy) noexcept
+{
+    return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(cx)) << 32)
+          | static_cast<std::uint32_t>(cy);
+}
+
+const SparseUniverse::Chunk* SparseUniverse::find(std::int64_t cx, std::int64_t cy) const noexcept
+{
+    auto it = index.find(key(cx, cy));
+    return it == index.end() ? nullptr : &chunks[static_cast<std::size_t>(it->second)];
+}
+
+SparseUniverse::Chunk& SparseUniverse::get_or_create(std::int64_t cx, std::int64_t cy)
+{
+    auto [it, inserted] = index.emplace(key(cx, cy), 0);
+    if (inserted) {
+        if (free_list.empty()) {
+            it->second = static_cast<int>(chunks.size());
+            chunks.emplace_back();
+        } else {
+            it->second = free_list.back();
+            free_list.pop_back();
+            chunks[static_cast<std::size_t>(it->second)] = Chunk{};
+        }
+        Chunk& c = chunks[static_cast<std::size_t>(it->second)];
+        c.cx = cx;
+        c.cy = cy;
+    }
+    return chunks[static_cast<std::size_t>(it->second)];
+}
+
+void SparseUniverse::release(int idx)
+{
+    const Chunk& c = chunks[static_cast<std::size_t>(idx)];
+    index.erase(key(c.cx, c.cy));
+    free_list.push_back(idx);
+}
+
+bool SparseUniverse::live(std::int64_t x, std::int64_t y) const noexcept
+{
+    const Chunk* c = find(floor_div(x, CHUNK), floor_div(y, CHUNK));
+    if (!c) {
+        return false;
+    }
+    return (c->rows[floor_mod(y, CHUNK)] >> floor_mod(x, CHUNK)) & 1;
+}
+
+bool SparseUniverse::dead(std::int64_t x, std::int64_t y) const noexcept
+{
+    return !live(x, y);
+}
+
+void SparseUniverse::set_live(std::int64_t x, std::int64_t y)
+{
+    Chunk& c = get_or_create(floor_div(x, CHUNK), floor_div(y, CHUNK));
+    c.rows[floor_mod(y, CHUNK)] |= std::uint64_t{1} << floor_mod(x, CHUNK);
+}
+
+// Empty chunks are left for the next step to free.
+void SparseUniverse::set_dead(std::int64_t x, std::int64_t y)
+{
+    auto it = index.find(key(floor_div(x, CHUNK), floor_div(y, CHUNK)));
+    if (it != index.end()) {
+        Chunk& c = chunks[static_cast<std::size_t>(it->second)];
+        c.rows[floor_mod(y, CHUNK)] &= ~(std::uint64_t{1} << floor_mod(x, CHUNK));
+    }
+}
+
+std::uint64_t SparseUniverse::population() const noexcept
+{
+    std::uint64_t result = 0;
+    for (auto&& [k, idx] : index) {
+        for (std::uint64_t w : chunks[static_cast<std::size_t>(idx)].rows) {
+            result += static_cast<std::uint64_t>(__builtin_popcountll(w));
+        }
+    }
+    return result;
+}
+
+// Make sure every chunk that could receive a birth exists: a live cell on
+// a chunk's border can only affect the neighbour on that side.
+void SparseUniverse::grow_frontier()
+{
+    frontier.clear();
+    for (auto&& [k, idx] : index) {
+        const Chunk& c = chunks[static_cast<std::size_t>(idx)];
+        std::uint64_t any = 0;
+        std::uint64_t west = 0;
+        std::uint64_t east = 0;
+        for (std::uint64_t w : c.rows) {
+            any |= w;
+            west |= w & 1;
+            east |= w >> 63;
+        }
+        if (any == 0) {
+            continue;
+        }
+        const bool n = c.rows[0] != 0;
+        const bool s = c.rows[CHUNK - 1] != 0;
+        const bool w = west != 0;
+        const bool e = east != 0;
+        const bool nw = (c.rows[0] & 1) != 0;
+        const bool ne = (c.rows[0] >> 63) != 0;
+        const bool sw = (c.rows[CHUNK - 1] & 1) != 0;
+        const bool se = (c.rows[CHUNK - 1] >> 63) != 0;
+        const std::pair<bool, std::pair<int, int>> sides[] = {
+            { n,  {  0, -1 } }, { s,  {  0, 1 } }, { w,  { -1, 0 } }, { e,  { 1, 0 } },
+            { nw, { -1, -1 } }, { ne, {  1, -1 } }, { sw, { -1, 1 } }, { se, { 1, 1 } },
+        };
+        for (auto&& [touches, d] : sides) {
+            if (touches && !find(c.cx + d.first, c.cy + d.second)) {
+                frontier.emplace_back(c.cx + d.first, c.cy + d.second);
+            }
+        }
+    }
+    for (auto&& [cx, cy] : frontier) {
+        get_or_create(cx, cy);
+    }
+}
+
+void SparseUniverse::compute(Chunk& c) const noexcept
+{
+    // Rows -1..CHUNK of the west, centre and east chunk columns, with
+    // missing chunks read as dead.
+    std::uint64_t col[3][CHUNK + 2];
+    for (int dx = -1; dx <= 1; ++dx) {
+        std::uint64_t* out = col[dx + 1];
+        const Chunk* north = find(c.cx + dx, c.cy - 1);
+        const Chunk* mid   = dx == 0 ? &c : find(c.cx + dx, c.cy);
+        const Chunk* south = find(c.cx + dx, c.cy + 1);
+        out[0] = north ? north->rows[CHUNK - 1] : 0;
+        if (mid) {
+            std::copy(mid->rows, mid->rows + CHUNK, out + 1);
+        } else {
+            std::fill(out + 1, out + CHUNK + 1, 0);
+        }
+        out[CHUNK + 1] = south ? south->rows[0] : 0;
+    }
+    const std::uint64_t* w = col[0];
+    const std::uint64_t* m = col[1];
+    const std::uint64_t* e = col[2];
+    for (int r = 1; r <= CHUNK; ++r) {
+        c.next[r - 1] = bits::life(
+                bits::west(w[r - 1], m[r - 1]), m[r - 1], bits::east(m[r - 1], e[r - 1]),
+                bits::west(w[r],     m[r]),     m[r],     bits::east(m[r],     e[r]),
+                bits::west(w[r + 1], m[r + 1]), m[r + 1], bits::east(m[r + 1], e[r + 1]));
+    }
+}
+
+void SparseUniverse::step(std::int64_t n)
+{
+    for (std::int64_t i = 0; i < n; ++i) {
+        grow_frontier();
+        live_list.clear();
+        for (auto&& [k, idx] : index) {
+            live_list.push_back(idx);
+        }
+        for (int idx : live_list) {
+            compute(chunks[static_cast<std::size_t>(idx)]);
+        }
+        for (int idx : live_list) {
+            Chunk& c = chunks[static_cast<std::size_t>(idx)];
+            std::copy(c.next, c.next + CHUNK, c.rows);
+            if (std::all_of(c.rows, c.rows + CHUNK, [](std::uint64_t w) { return w == 0; })) {
+                release(idx);
+            }
+        }
+        ++gen;
+    }
+}
+
+bool SparseUniverse::bounds(Bounds& out) const noexcept
+{
+    bool found = false;
+    for_each_live([&](std::int64_t x, std::int64_t y) {
+        if (!found) {
+            out = { x, y, x + 1, y + 1 };
+            found = true;
+            return;
+        }
+        out.x0 = std::min(out.x0, x);
+        out.y0 = std::min(out.y0, y);
+        out.x1 = std::max(out.x1, x + 1);
+        out.y1 = std::max(out.y1, y + 1);
+    });
+    return found;
+}
+
+Board SparseUniverse::to_board(std::int64_t x0, std::int64_t y0, int nrows, int ncols) const
+{
+    Board b(nrows, ncols);
+    for_each_live([&](std::int64_t x, std::int64_t y) {
+        if (x0 <= x && x < x0 + ncols && y0 <= y && y < y0 + nrows) {
+            b.set_live(static_cast<int>(x - x0), static_cast<int>(y - y0));
+        }
+    });
+    return b;
+}
+
+} // namespace gol
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace gol {
+
+struct Board;
+
+// Unbounded universe made of 64x64 bit-packed chunks kept in a hash map
+// keyed by chunk coordinates.  Only chunks with live cells are stored: a
+// step creates the neighbouring chunks a pattern can grow into and frees
+// the ones that end up empty, so memory follows the live area rather than
+// the bounding box and patterns can travel indefinitely.
+class SparseUniverse
+{
+public:
+    static constexpr int CHUNK = 64;
+
+    struct Bounds
+    {
+        std::int64_t x0, y0; // inclusive
+        std::int64_t x1, y1; // exclusive
+    };
+
+    SparseUniverse() = default;
+    explicit SparseUniverse(const Board& b);
+
+    bool live(std::int64_t x, std::int64_t y) const noexcept;
+    bool dead(std::int64_t x, std::int64_t y) const noexcept;
+    void set_live(std::int64_t x, std::int64_t y);
+    void set_dead(std::int64_t x, std::int64_t y);
+
+    void step(std::int64_t n = 1);
+    std::int64_t generation() const noexcept { return gen; }
+    std::uint64_t population() const noexcept;
+    std::size_t chunk_count() const noexcept { return index.size(); }
+    bool empty() const noexcept { return population() == 0; }
+
+    // Smallest box holding every live cell; false if there are none.
+    bool bounds(Bounds& out) const noexcept;
+    // The nrows x ncols window whose top-left cell is (x0, y0).
+    Board to_board(std::int64_t x0, std::int64_t y0, int nrows, int ncols) const;
+
+    template <class F>
+    void for_each_live(F&& fn) const
+    {
+        for (auto&& [key, idx] : index) {
+            const Chunk& c = chunks[static_cast<std::size_t>(idx)];
+            for (int r = 0; r < CHUNK; ++r) {
+                for (std::uint64_t w = c.rows[r]; w != 0; w &= w - 1) {
+                    fn(c.cx*CHUNK + __builtin_ctzll(w), c.cy*CHUNK + r);
+                }
+            }
+        }
+    }
+
+private:
+    struct Chunk
+    {
+        std::int64_t cx = 0;
+        std::int64_t cy = 0;
+        std::uint64_t rows[CHUNK] = {};
+        std::uint64_t next[CHUNK] = {};
+    };
+
+    static std::uint64_t key(std::int64_t cx, std::int64_t cy) noexcept;
+    const Chunk* find(std::int64_t cx, std::int64_t cy) const noexcept;
+    Chunk& get_or_create(std::int64_t cx, std::int64_t cy);
+    void release(int idx);
+    void grow_frontier();
+    void compute(Chunk& c) const noexcept;
+
+    std::vector<Chunk> chunks;
+    std::vector<int> free_list;
+    std::unordered_map<std::uint64_t, int> index;
+    std::vector<int> live_list;
+    std::vector<std::pair<std::int64_t, std::int64_t>> frontier;
+    std::int64_t gen = 0;
+};
+
+} // namespace gol
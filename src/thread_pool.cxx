@@ -0,0 +1,122 @@
+#include "thread_pool.h"
+
+namespace gol {
+
+ThreadPool::ThreadPool(int nthreads)
+{
+    if (nthreads <= 0) {
+        nthreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    }
+    nqueues = nthreads;
+    queues = std::make_unique<Queue[]>(static_cast<std::size_t>(nqueues));
+    workers.reserve(static_cast<std::size_t>(nthreads - 1));
+    for (int id = 1; id < nthreads; ++id) {
+        workers.emplace_back([this, id] { worker_loop(id); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        stop = true;
+    }
+    wake_cv.notify_all();
+    for (auto& t : workers) {
+        t.join();
+    }
+}
+
+int ThreadPool::size() const noexcept
+{
+    return nqueues;
+}
+
+void ThreadPool::run(int ntasks, void (*fn)(void*, int), void* ctx)
+{
+    if (ntasks <= 0) {
+        return;
+    }
+    if (nqueues == 1 || ntasks == 1) {
+        for (int i = 0; i < ntasks; ++i) {
+            fn(ctx, i);
+        }
+        return;
+    }
+
+    // The job is published before the queues are filled; a worker only
+    // reads it after taking a task under its queue lock.
+    job_fn = fn;
+    job_ctx = ctx;
+    remaining.store(ntasks, std::memory_order_relaxed);
+    for (int id = 0; id < nqueues; ++id) {
+        Queue& q = queues[static_cast<std::size_t>(id)];
+        std::lock_guard<std::mutex> lk(q.mtx);
+        q.begin = static_cast<int>(static_cast<std::int64_t>(ntasks) * id / nqueues);
+        q.end = static_cast<int>(static_cast<std::int64_t>(ntasks) * (id + 1) / nqueues);
+    }
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        ++epoch;
+    }
+    wake_cv.notify_all();
+
+    work(0);
+
+    std::unique_lock<std::mutex> lk(mtx);
+    done_cv.wait(lk, [this] { return remaining.load(std::memory_order_acquire) == 0; });
+}
+
+void ThreadPool::worker_loop(int id)
+{
+    std::uint64_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lk(mtx);
+            wake_cv.wait(lk, [&] { return stop || epoch != seen; });
+            if (stop) {
+                return;
+            }
+            seen = epoch;
+        }
+        work(id);
+    }
+}
+
+void ThreadPool::work(int id)
+{
+    int task;
+    while (pop(id, task) || steal(id, task)) {
+        job_fn(job_ctx, task);
+        if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> lk(mtx);
+            done_cv.notify_all();
+        }
+    }
+}
+
+bool ThreadPool::pop(int id, int& task)
+{
+    Queue& q = queues[static_cast<std::size_t>(id)];
+    std::lock_guard<std::mutex> lk(q.mtx);
+    if (q.begin == q.end) {
+        return false;
+    }
+    task = q.begin++;
+    return true;
+}
+
+bool ThreadPool::steal(int id, int& task)
+{
+    for (int i = 1; i < nqueues; ++i) {
+        Queue& q = queues[static_cast<std::size_t>((id + i) % nqueues)];
+        std::lock_guard<std::mutex> lk(q.mtx);
+        if (q.begin != q.end) {
+            task = --q.end;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace gol
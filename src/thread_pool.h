@@ -0,0 +1,85 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace gol {
+
+// Persistent pool of worker threads.  Each call to parallel_for() deals the
+// task indices out to per-thread queues as contiguous ranges; a thread that
+// runs dry steals from the back of another thread's range, so uneven tasks
+// still balance out.  The calling thread takes part as worker 0.
+class ThreadPool
+{
+public:
+    // nthreads <= 0 uses std::thread::hardware_concurrency().
+    explicit ThreadPool(int nthreads = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Number of threads doing work, including the caller.
+    int size() const noexcept;
+
+    // Run fn(i) for every i in [0, ntasks) and wait for all of them.  Only
+    // one thread may call this at a time.
+    template <class F>
+    void parallel_for(int ntasks, F&& fn)
+    {
+        using Fn = std::remove_reference_t<F>;
+        auto thunk = [](void* ctx, int i) { (*static_cast<Fn*>(ctx))(i); };
+        run(ntasks, thunk, const_cast<void*>(static_cast<const void*>(std::addressof(fn))));
+    }
+
+private:
+    struct alignas(64) Queue
+    {
+        std::mutex mtx;
+        int begin = 0;
+        int end = 0;
+    };
+
+    void run(int ntasks, void (*fn)(void*, int), void* ctx);
+    void worker_loop(int id);
+    void work(int id);
+    bool pop(int id, int& task);
+    bool steal(int id, int& task);
+
+    std::vector<std::thread> workers;
+    std::unique_ptr<Queue[]> queues;
+    int nqueues = 0;
+
+    void (*job_fn)(void*, int) = nullptr;
+    void* job_ctx = nullptr;
+    std::atomic<int> remaining{0};
+
+    std::mutex mtx;
+    std::condition_variable wake_cv;
+    std::condition_variable done_cv;
+    std::uint64_t epoch = 0;
+    bool stop = false;
+};
+
+// Split rows [0, nrows) into bands and run fn(y0, y1) for each one on the
+// pool.  There are a few bands per thread so stealing can even out the load,
+// but no band is smaller than `min_rows`.
+template <class F>
+void parallel_rows(ThreadPool& pool, int nrows, F&& fn, int min_rows = 8)
+{
+    const int want = pool.size() * 4;
+    const int nbands = std::max(1, std::min(want, nrows / std::max(1, min_rows)));
+    pool.parallel_for(nbands, [&](int band) {
+        const int y0 = static_cast<int>(static_cast<std::int64_t>(nrows) * band / nbands);
+        const int y1 = static_cast<int>(static_cast<std::int64_t>(nrows) * (band + 1) / nbands);
+        fn(y0, y1);
+    });
+}
+
+} // namespace gol
@@ -0,0 +1,145 @@
+#include "tiled.h"
+#include "golife.h"
+#include "metrics.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+namespace gol {
+
+// Both buffers always hold complete generations: `front` is generation g
+// and `back` is g-1.  A tile that is skipped had a stable neighbourhood
+// from g-1 to g, so its next state equals g, which is also what `back`
+// already holds for it.  Only recomputed tiles need to be written.
+
+TiledBoard::TiledBoard(BitBoard initial, Rule rule)
+    : front{std::move(initial)}
+    , back{front}
+    , life_rule{rule}
+    , tiles_x{front.nwords}
+    , tiles_y{(front.nrows + TILE_ROWS - 1) / TILE_ROWS}
+    , changed(static_cast<std::size_t>(tiles_x * tiles_y), 1)
+    , marks(static_cast<std::size_t>(tiles_x * tiles_y), 0)
+{
+    active.reserve(changed.size());
+    previous.reserve(changed.size());
+    for (int tile = 0; tile < total_tiles(); ++tile) {
+        mark_around(tile);
+    }
+}
+
+TiledBoard::TiledBoard(const Board& initial, Rule rule)
+    : TiledBoard(BitBoard(initial), rule) {}
+
+void TiledBoard::set_live(int x, int y) noexcept
+{
+    front.set_live(x, y);
+    touch(x, y);
+}
+
+void TiledBoard::set_dead(int x, int y) noexcept
+{
+    front.set_dead(x, y);
+    touch(x, y);
+}
+
+void TiledBoard::flip_state(int x, int y) noexcept
+{
+    front.flip_state(x, y);
+    touch(x, y);
+}
+
+void TiledBoard::touch(int x, int y) noexcept
+{
+    const int tile = (y / TILE_ROWS)*tiles_x + x / TILE_COLS;
+    if (!changed[static_cast<std::size_t>(tile)]) {
+        changed[static_cast<std::size_t>(tile)] = 1;
+        mark_around(tile);
+    }
+}
+
+void TiledBoard::step(std::int64_t n) noexcept
+{
+    for (std::int64_t i = 0; i < n; ++i) {
+        for (int tile : active) {
+            changed[static_cast<std::size_t>(tile)] = step_tile(tile);
+        }
+        finish_step();
+    }
+}
+
+void TiledBoard::step(std::int64_t n, ThreadPool& pool) noexcept
+{
+    for (std::int64_t i = 0; i < n; ++i) {
+        const int ntasks = std::min(active_tiles(), pool.size() * 8);
+        const int nactive = active_tiles();
+        pool.parallel_for(ntasks, [&](int task) {
+            const int lo = static_cast<int>(static_cast<std::int64_t>(nactive) * task / ntasks);
+            const int hi = static_cast<int>(static_cast<std::int64_t>(nactive) * (task + 1) / ntasks);
+            for (int j = lo; j < hi; ++j) {
+                const int tile = active[static_cast<std::size_t>(j)];
+                changed[static_cast<std::size_t>(tile)] = step_tile(tile);
+            }
+        });
+        finish_step();
+    }
+}
+
+// Recompute one tile into `back` and report whether it differs from `front`.
+bool TiledBoard::step_tile(int tile) noexcept
+{
+    const int w = tile % tiles_x;
+    const int y0 = (tile / tiles_x)*TILE_ROWS;
+    const int y1 = std::min(y0 + TILE_ROWS, front.nrows);
+    front.tick_region(back, y0, y1, w, w + 1, life_rule);
+    count_cells(static_cast<std::uint64_t>(y1 - y0)*static_cast<std::uint64_t>(std::min(TILE_COLS, front.ncols - w*TILE_COLS)));
+    std::uint64_t diff = 0;
+    for (int y = y0; y < y1; ++y) {
+        const std::size_t i = static_cast<std::size_t>(y*front.nwords + w);
+        diff |= front.words[i] ^ back.words[i];
+    }
+    return diff != 0;
+}
+
+void TiledBoard::finish_step() noexcept
+{
+    std::swap(front, back);
+    ++gen;
+    count_generation();
+    plan();
+}
+
+// The next step recomputes every tile within one tile of a changed one.
+// Only tiles that were just recomputed (or edited) can have changed, so
+// this is proportional to the activity too.
+void TiledBoard::plan() noexcept
+{
+    std::swap(active, previous);
+    active.clear();
+    for (int tile : previous) {
+        marks[static_cast<std::size_t>(tile)] = 0;
+    }
+    for (int tile : previous) {
+        if (changed[static_cast<std::size_t>(tile)]) {
+            mark_around(tile);
+        }
+    }
+}
+
+void TiledBoard::mark_around(int tile) noexcept
+{
+    const int tx = tile % tiles_x;
+    const int ty = tile / tiles_x;
+    for (int ny = std::max(0, ty - 1); ny <= std::min(tiles_y - 1, ty + 1); ++ny) {
+        for (int nx = std::max(0, tx - 1); nx <= std::min(tiles_x - 1, tx + 1); ++nx) {
+            const int n = ny*tiles_x + nx;
+            if (!marks[static_cast<std::size_t>(n)]) {
+                marks[static_cast<std::size_t>(n)] = 1;
+                active.push_back(n);
+            }
+        }
+    }
+}
+
+} // namespace gol
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "bitboard.h"
+#include <cstdint>
+#include <vector>
+
+namespace gol {
+
+struct Board;
+class ThreadPool;
+
+// BitBoard split into tiles of 64x64 cells (one word wide) that each carry
+// a changed flag.  A step only recomputes the tiles that changed last
+// generation or border one that did; everything else is known to be stable
+// and is left alone, so the cost of a step follows the activity on the
+// board rather than its area.
+class TiledBoard
+{
+public:
+    static constexpr int TILE_ROWS = 64;
+    static constexpr int TILE_COLS = 64;
+
+    TiledBoard() = default;
+    explicit TiledBoard(BitBoard initial, Rule rule = {});
+    explicit TiledBoard(const Board& initial, Rule rule = {});
+
+    const BitBoard& current() const noexcept { return front; }
+    // The generation before current(), or current() itself before the
+    // first step.
+    const BitBoard& prior() const noexcept { return back; }
+    std::int64_t generation() const noexcept { return gen; }
+    Rule rule() const noexcept { return life_rule; }
+    bool live(int x, int y) const noexcept { return front.live(x, y); }
+    bool dead(int x, int y) const noexcept { return front.dead(x, y); }
+    void set_live(int x, int y) noexcept;
+    void set_dead(int x, int y) noexcept;
+    void flip_state(int x, int y) noexcept;
+
+    void step(std::int64_t n = 1) noexcept;
+    void step(std::int64_t n, ThreadPool& pool) noexcept;
+
+    // Tiles that the next step will recompute, out of total_tiles().
+    int active_tiles() const noexcept { return static_cast<int>(active.size()); }
+    int total_tiles() const noexcept { return tiles_x * tiles_y; }
+
+private:
+    void touch(int x, int y) noexcept;
+    bool step_tile(int tile) noexcept;
+    void finish_step() noexcept;
+    void plan() noexcept;
+    void mark_around(int tile) noexcept;
+
+    BitBoard front = {};
+    BitBoard back = {};
+    std::int64_t gen = 0;
+    Rule life_rule = {};
+    int tiles_x = 0;
+    int tiles_y = 0;
+    std::vector<std::uint8_t> changed;
+    std::vector<std::uint8_t> marks;
+    std::vector<int> active;
+    std::vector<int> previous;
+};
+
+} // namespace gol
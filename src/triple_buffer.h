@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+
+namespace gol {
+
+// Lock-free handoff of the latest value from one writer thread to one
+// reader thread.  The writer fills back() and publish()es it; the reader
+// calls update() and then looks at front().  Neither side ever waits: a
+// value the reader did not get to in time is simply replaced by a newer
+// one, and the reader keeps its front() until it asks for another.
+template <class T>
+class TripleBuffer
+{
+public:
+    // Writer side.
+    T& back() noexcept { return slots[back_idx].value; }
+
+    void publish() noexcept
+    {
+        back_idx = middle.exchange(back_idx | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Whether the reader has taken the last published value.
+    bool consumed() const noexcept
+    {
+        return (middle.load(std::memory_order_acquire) & FRESH) == 0;
+    }
+
+    // Reader side.  Returns true if front() changed.
+    bool update() noexcept
+    {
+        if ((middle.load(std::memory_order_relaxed) & FRESH) == 0) {
+            return false;
+        }
+        front_idx = middle.exchange(front_idx, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    const T& front() const noexcept { return slots[front_idx].value; }
+
+private:
+    static constexpr unsigned INDEX = 3;
+    static constexpr unsigned FRESH = 4;
+
+    struct alignas(64) Slot
+    {
+        T value = {};
+    };
+
+    Slot slots[3];
+    alignas(64) std::atomic<unsigned> middle{1};
+    alignas(64) unsigned back_idx = 0;  // writer only
+    alignas(64) unsigned front_idx = 2; // reader only
+};
+
+} // namespace gol
@@ -2,6 +2,7 @@
 #include <GLFW/glfw3.h>
 
 #include <cstdio>
+#include <cfloat>
 #include <array>
 #include <string>
 #include <vector>
@@ -10,6 +11,7 @@
 #include <variant>
 #include <fstream>
 #include <chrono>
+#include <optional>
 
 #include <fmt/format.h>
 #include <fmt/ostream.h>
@@ -18,7 +20,12 @@
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 
+#include "checkpoint.h"
 #include "golife.h"
+#include "metrics.h"
+#include "simulation.h"
+#include "pattern.h"
+#include "grid_view.h"
 
 
 #define DEBUG(format, ...) fmt::print(std::cerr, "[DEBUG ({:s})]: " format "\n", __func__, ##__VA_ARGS__)
@@ -58,46 +65,125 @@ struct GameOfLife
     int window_w;
     int window_h;
     gol::Board setupBoard = {};
-    std::vector<gol::Board> boards;
+    gol::Rule rule = {};
+    gol::Simulation sim;
+    GridView view;
 
     bool      playing = false;
-    TimePoint next_tick_ts = {};
+    bool      fast    = false; // as fast as possible instead of tick_period
     Duration  tick_period  = {};
+
+    std::string checkpoint_path = "golife.ckpt";
+    std::string checkpoint_status;
+
+    bool      show_metrics = false;
+    gol::TickCounters counters = {}; // as of counters_time, for the rates
+    TimePoint counters_time = {};
+    double    cells_per_sec = 0;
 };
 
-bool IsSteadyState(GameOfLife& state)
+std::chrono::nanoseconds TickPeriod(const GameOfLife& state)
+{
+    if (state.fast) {
+        return std::chrono::nanoseconds::zero();
+    }
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(state.tick_period);
+}
+
+std::string FormatLatency(std::chrono::nanoseconds t)
 {
-    auto& boards = state.boards;
-    auto& board = boards.back();
-    if (board.empty()) {
-        return true;
+    const double ns = static_cast<double>(t.count());
+    if (ns < 1e3) {
+        return fmt::format("{:.0f} ns", ns);
     }
-    if (boards.size() <= 1) {
-        return false;
+    if (ns < 1e6) {
+        return fmt::format("{:.1f} us", ns / 1e3);
     }
-    auto& board2 = boards[boards.size() - 2];
-    return board == board2;
+    return fmt::format("{:.2f} ms", ns / 1e6);
 }
 
-void ShowGameOfLifeWindow(bool* show_game_of_life_window, GameOfLife& state)
+void ShowMetricsWindow(bool* show_metrics, GameOfLife& state, const gol::TickMetrics& metrics)
 {
-    auto& boards = state.boards;
+    // the kernel counters are summed over threads, so only sample them
+    // a few times a second
+    const auto now = GameOfLife::Clock::now();
+    if (now - state.counters_time > std::chrono::milliseconds(500)) {
+        const gol::TickCounters c = gol::tick_counters();
+        const double secs = std::chrono::duration<double>(now - state.counters_time).count();
+        state.cells_per_sec = static_cast<double>(c.cells - state.counters.cells) / secs;
+        state.counters = c;
+        state.counters_time = now;
+    }
 
-    if (!state.setup_mode && state.playing) {
-        auto now = GameOfLife::Clock::now();
-        if (now >= state.next_tick_ts) {
-            state.next_tick_ts = now + state.tick_period;
-            boards.push_back(boards.back().tick());
+    ImGui::SetNextWindowSize(ImVec2(420, 520), ImGuiCond_FirstUseEver);
+    if (ImGui::Begin("Metrics", show_metrics))
+    {
+        const gol::LatencyHistogram& h = metrics.latency();
+        ImGui::Text("Generations: %llu", static_cast<unsigned long long>(metrics.ticks()));
+        ImGui::Text("Tick mean %s  p50 %s  p99 %s  max %s",
+                FormatLatency(h.mean()).c_str(), FormatLatency(h.quantile(0.5)).c_str(),
+                FormatLatency(h.quantile(0.99)).c_str(), FormatLatency(h.max()).c_str());
+        if (const gol::TickSample* last = metrics.last()) {
+            ImGui::Text("Population: %lld", static_cast<long long>(last->change.population));
+            ImGui::Text("Last generation: %lld born, %lld died, %lld changed",
+                    static_cast<long long>(last->change.births), static_cast<long long>(last->change.deaths),
+                    static_cast<long long>(last->change.changed()));
+        }
+        ImGui::Text("Total: %lld born, %lld died",
+                static_cast<long long>(metrics.births()), static_cast<long long>(metrics.deaths()));
+        ImGui::Text("Kernels: %.3g cells/s", state.cells_per_sec);
+
+        const auto recent = metrics.recent();
+        std::vector<float> latency_us, population, changed;
+        for (auto&& s : recent) {
+            latency_us.push_back(static_cast<float>(s.latency.count()) / 1e3f);
+            population.push_back(static_cast<float>(s.change.population));
+            changed.push_back(static_cast<float>(s.change.changed()));
+        }
+        const ImVec2 plot_size(-1, 60);
+        ImGui::PlotLines("##latency", latency_us.data(), static_cast<int>(latency_us.size()),
+                0, "tick latency (us)", 0, FLT_MAX, plot_size);
+        ImGui::PlotLines("##population", population.data(), static_cast<int>(population.size()),
+                0, "population", FLT_MAX, FLT_MAX, plot_size);
+        ImGui::PlotLines("##changed", changed.data(), static_cast<int>(changed.size()),
+                0, "changed cells", 0, FLT_MAX, plot_size);
+
+        // only the span of buckets that has been hit
+        const auto& buckets = h.buckets();
+        int lo = 0;
+        int hi = gol::LatencyHistogram::BUCKETS;
+        while (lo < hi && buckets[static_cast<std::size_t>(lo)] == 0) {
+            ++lo;
+        }
+        while (hi > lo && buckets[static_cast<std::size_t>(hi - 1)] == 0) {
+            --hi;
         }
-        if (IsSteadyState(state)) {
-            state.playing = false;
+        std::vector<float> bars;
+        for (int i = lo; i < hi; ++i) {
+            bars.push_back(static_cast<float>(buckets[static_cast<std::size_t>(i)]));
         }
+        const std::string range = hi > lo
+            ? FormatLatency(gol::LatencyHistogram::bucket_limit(lo) / 2) + " .. " + FormatLatency(gol::LatencyHistogram::bucket_limit(hi - 1))
+            : std::string("latency histogram");
+        ImGui::PlotHistogram("##histogram", bars.data(), static_cast<int>(bars.size()),
+                0, range.c_str(), 0, FLT_MAX, ImVec2(-1, 80));
+    }
+    ImGui::End();
+}
+
+void ShowGameOfLifeWindow(bool* show_game_of_life_window, GameOfLife& state)
+{
+    auto& sim = state.sim;
+
+    if (state.playing && !sim.running()) {
+        // the simulation stopped by itself: the board died out or repeats
+        sim.stop();
+        state.playing = false;
     }
 
-    auto& board = boards.back();
+    const auto& snapshot = sim.snapshot();
+    auto& board = snapshot.board;
     auto& setupBoard = state.setupBoard;
-    const int xmax = board.ncols;
-    const int ymax = board.nrows;
 
     ImGui::SetNextWindowPos(ImVec2(0, 0));
     ImGui::SetNextWindowSize(ImVec2(state.window_w, state.window_h));
@@ -105,96 +191,113 @@ void ShowGameOfLifeWindow(bool* show_game_of_life_window, GameOfLife& state)
     const auto window_flags = 0
         | ImGuiWindowFlags_NoDecoration
         | ImGuiWindowFlags_NoCollapse
-        | ImGuiWindowFlags_AlwaysAutoResize
         ;
     if (ImGui::Begin("Game Of Life", show_game_of_life_window, window_flags))
     {
+        const float controls_h = 40 + ImGui::GetTextLineHeightWithSpacing() + 2*ImGui::GetStyle().ItemSpacing.y;
+        const ImVec2 avail = ImGui::GetContentRegionAvail();
+        const ImVec2 grid_size(avail.x, avail.y - controls_h);
+        state.view.live_color = ImGui::ColorConvertFloat4ToU32(LiveColor);
+        state.view.dead_color = ImGui::ColorConvertFloat4ToU32(DeadColor);
+
         if (state.setup_mode) {
-            int id = 0;
-            for (int y = 0; y < ymax; ++y) {
-                for (int x = 0; x < xmax; ++x) {
-                    ImGui::PushID(id++);
-                    const auto square_color = GetColor(setupBoard.live(x, y));
-                    ImGui::PushStyleColor(ImGuiCol_Button, square_color);
-                    ImGui::PushStyleColor(ImGuiCol_ButtonHovered, square_color);
-                    ImGui::PushStyleColor(ImGuiCol_ButtonActive, square_color);
-                    ImGui::SameLine(/*offset_from_start_x*/0., /*spacing*/5.);
-                    if (ImGui::Button("", ImVec2(40, 40))) {
-                        setupBoard.flip_state(x, y);
-                    }
-                    ImGui::PopStyleColor(3);
-                    ImGui::PopID();
-                }
-                ImGui::NewLine();
+            int x, y;
+            if (state.view.Draw(setupBoard, grid_size, &x, &y)) {
+                setupBoard.flip_state(x, y);
             }
-            ImGui::NewLine();
 
             const int button_w = 100;
-            ImGui::SameLine(state.window_w / 2 - button_w / 2, 0);
+            ImGui::SetCursorPosX(state.window_w / 2 - button_w / 2);
             if (ImGui::Button("Done", ImVec2(button_w, 40)))
             {
                 state.setup_mode = false;
-                state.boards.clear();
-                state.boards.emplace_back(state.setupBoard);
+                sim.reset(state.setupBoard, state.rule);
             }
-        } else {
-            int id = 0;
-            for (int y = 0; y < ymax; ++y) {
-                for (int x = 0; x < xmax; ++x) {
-                    ImGui::PushID(id++);
-                    const auto square_color = GetColor(board.live(x, y));
-                    ImGui::PushStyleColor(ImGuiCol_Button, square_color);
-                    ImGui::PushStyleColor(ImGuiCol_ButtonHovered, square_color);
-                    ImGui::PushStyleColor(ImGuiCol_ButtonActive, square_color);
-                    ImGui::SameLine(/*offset_from_start_x*/0., /*spacing*/5.);
-                    ImGui::Button("", ImVec2(40, 40));
-                    ImGui::PopStyleColor(3);
-                    ImGui::PopID();
-                }
-                ImGui::NewLine();
+            ImGui::SameLine(0, 5);
+            if (ImGui::Button("Fit", ImVec2(button_w, 40)))
+            {
+                state.view.Fit();
             }
-            ImGui::NewLine();
+        } else {
+            int x, y;
+            state.view.Draw(board, grid_size, &x, &y);
 
-            ImGui::Text("Iteration: %zu", boards.size());
+            ImGui::Text("Iteration: %zu", snapshot.generation);
+            if (snapshot.cycle) {
+                ImGui::SameLine(0, 20);
+                ImGui::Text("Period %zu from iteration %zu", snapshot.cycle->period, snapshot.cycle->start + 1);
+            }
+            ImGui::SameLine(0, 20);
+            if (ImGui::Checkbox("As fast as possible", &state.fast)) {
+                sim.set_period(TickPeriod(state));
+            }
+            ImGui::SameLine(0, 20);
+            ImGui::Checkbox("Metrics", &state.show_metrics);
             if (state.playing) {
                 if (ImGui::Button("Stop", ImVec2(100, 40)))
                 {
+                    sim.stop();
                     state.playing = false;
                 }
+                ImGui::SameLine(0, 5);
+                if (ImGui::Button("Fit", ImVec2(100, 40)))
+                {
+                    state.view.Fit();
+                }
             } else {
                 if (ImGui::Button("Play", ImVec2(100, 40)))
                 {
+                    sim.start(TickPeriod(state));
                     state.playing = true;
                 }
                 ImGui::SameLine(0, 5);
                 if (ImGui::Button("Prev", ImVec2(100, 40)))
                 {
-                    if (boards.size() > 1) {
-                        boards.pop_back();
-                    }
+                    sim.rewind();
                 }
                 ImGui::SameLine(0, 5);
                 if (ImGui::Button("Next", ImVec2(100, 40)))
                 {
-                    boards.push_back(board.tick());
+                    sim.advance();
                 }
                 ImGui::SameLine(0, 5);
                 if (ImGui::Button("Setup", ImVec2(100, 40)))
                 {
                     state.setup_mode = true;
-                    state.setupBoard = boards.back();
+                    state.setupBoard = sim.history().latest();
                 }
                 ImGui::SameLine(0, 5);
                 if (ImGui::Button("Reset", ImVec2(100, 40)))
                 {
-                    state.setupBoard = boards[0];
-                    state.boards.clear();
-                    state.boards.emplace_back(state.setupBoard);
+                    state.setupBoard = sim.history().at(0);
+                    sim.reset(state.setupBoard, state.rule);
+                }
+                ImGui::SameLine(0, 5);
+                if (ImGui::Button("Save", ImVec2(100, 40)))
+                {
+                    try {
+                        sim.save_checkpoint(state.checkpoint_path);
+                        state.checkpoint_status = "saved " + state.checkpoint_path;
+                    } catch (const std::exception& e) {
+                        state.checkpoint_status = e.what();
+                    }
+                }
+                if (ImGui::IsItemHovered() && !state.checkpoint_status.empty()) {
+                    ImGui::SetTooltip("%s", state.checkpoint_status.c_str());
+                }
+                ImGui::SameLine(0, 5);
+                if (ImGui::Button("Fit", ImVec2(100, 40)))
+                {
+                    state.view.Fit();
                 }
             }
         }
     }
     ImGui::End();
+
+    if (state.show_metrics && !state.setup_mode) {
+        ShowMetricsWindow(&state.show_metrics, state, snapshot.metrics);
+    }
 }
 
 void OnWindowResize(GLFWwindow* window, int width, int height)
@@ -262,7 +365,6 @@ int main(int argc, char** argv)
         .window_w = start_window_w,
         .window_h = start_window_h,
         .setupBoard = { .nrows = 15, .ncols = 15 },
-        .boards = {},
         .tick_period = std::chrono::milliseconds(200),
     };
 
@@ -280,10 +382,31 @@ int main(int argc, char** argv)
         { 9, 6 },
         { 8, 5 },
     };
-    for (auto&& [x, y] : starting_position) {
-        gol_state.setupBoard.set_live(x, y);
+    const std::string path = argc > 1 ? argv[1] : "";
+    const std::string ckpt_ext = ".ckpt";
+    const bool resume = path.size() > ckpt_ext.size()
+        && path.compare(path.size() - ckpt_ext.size(), ckpt_ext.size(), ckpt_ext) == 0;
+    try {
+        if (resume) {
+            gol_state.sim.restore(gol::Checkpoint(path));
+            gol_state.rule = gol_state.sim.rule();
+            gol_state.setupBoard = gol_state.sim.history().at(0);
+            gol_state.setup_mode = false;
+            gol_state.checkpoint_path = path;
+        } else if (!path.empty()) {
+            gol_state.setupBoard = gol::load_pattern(path, &gol_state.rule);
+        } else {
+            for (auto&& [x, y] : starting_position) {
+                gol_state.setupBoard.set_live(x, y);
+            }
+        }
+    } catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    if (!resume) {
+        gol_state.sim.reset(gol_state.setupBoard, gol_state.rule);
     }
-    gol_state.boards.push_back(gol_state.setupBoard);
 
     glfwSetWindowUserPointer(window, &gol_state);
     glfwSetWindowSizeCallback(window, &OnWindowResize);
@@ -310,6 +433,7 @@ int main(int argc, char** argv)
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
         glfwSwapBuffers(window);
     }
+    gol_state.view.Release();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();